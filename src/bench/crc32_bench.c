@@ -0,0 +1,98 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "crc32.h"
+
+/* USAGE:
+ *   make bench && ./bench/crc32_bench [total_mb]
+ *
+ * Checks every available backend against the bitwise reference, then
+ * reports throughput for a 508-byte sector body and a 64 KiB buffer.
+ */
+
+#define CHECK_MAX_LEN 1024
+#define BIG_LEN (64u * 1024u)
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int check_backend(crc32_backend_t b, const uint8_t *data) {
+    for (size_t off = 0; off < 16; off++) {
+        for (size_t len = 0; len <= CHECK_MAX_LEN; len++) {
+            crc32_set_backend(CRC32_BACKEND_BITWISE);
+            uint32_t ref = crc32(data + off, len);
+            crc32_set_backend(b);
+            uint32_t got = crc32(data + off, len);
+            /* split anywhere: incremental must match one-shot */
+            size_t cut = len / 3;
+            uint32_t inc = crc32_update(crc32_update(0, data + off, cut),
+                                        data + off + cut, len - cut);
+            if (got != ref || inc != ref) {
+                printf("MISMATCH backend=%s off=%zu len=%zu ref=0x%08X got=0x%08X inc=0x%08X\n",
+                       crc32_backend_name(b), off, len, ref, got, inc);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static double run(const uint8_t *data, size_t len, size_t total) {
+    size_t iters = total / len;
+    if (iters == 0) iters = 1;
+    volatile uint32_t sink = 0;
+    double t0 = now_sec();
+    for (size_t i = 0; i < iters; i++)
+        sink ^= crc32(data, len);
+    double dt = now_sec() - t0;
+    (void)sink;
+    return ((double)iters * (double)len) / dt / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    size_t total_mb = (argc > 1) ? (size_t)strtoul(argv[1], NULL, 10) : 256;
+    size_t total = total_mb * 1024u * 1024u;
+
+    uint8_t *data = malloc(BIG_LEN + 16);
+    if (!data) return 1;
+    uint32_t x = 0x12345678u;
+    for (size_t i = 0; i < BIG_LEN + 16; i++) {
+        x = x * 1664525u + 1013904223u;
+        data[i] = (uint8_t)(x >> 24);
+    }
+
+    /* known answer for "123456789" */
+    if (crc32((const uint8_t *)"123456789", 9) != 0xCBF43926u) {
+        printf("known-answer test failed\n");
+        free(data);
+        return 1;
+    }
+
+    printf("backend,len,gb_per_s\n");
+    int failed = 0;
+    for (int b = CRC32_BACKEND_BITWISE; b < CRC32_BACKEND_COUNT; b++) {
+        if (!crc32_backend_available((crc32_backend_t)b)) continue;
+        if (check_backend((crc32_backend_t)b, data) != 0) {
+            failed = 1;
+            continue;
+        }
+        crc32_set_backend((crc32_backend_t)b);
+        /* the bitwise reference is slow, keep its run short */
+        size_t budget = (b == CRC32_BACKEND_BITWISE) ? total / 16 : total;
+        printf("%s,%u,%.3f\n", crc32_backend_name((crc32_backend_t)b), 508u,
+               run(data, 508, budget));
+        printf("%s,%u,%.3f\n", crc32_backend_name((crc32_backend_t)b), BIG_LEN,
+               run(data, BIG_LEN, budget));
+    }
+
+    crc32_set_backend(CRC32_BACKEND_AUTO);
+    printf("# auto selects: %s\n", crc32_backend_name(crc32_get_backend()));
+    free(data);
+    return failed;
+}
@@ -0,0 +1,430 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "driver.h"
+#include "linux_driver.h"
+#include "ram_driver.h"
+#include "storage.h"
+
+/* USAGE:
+ *   make bench && ./bench/storage_bench [options]
+ *
+ *   -d ram|mmap|linux|uring   driver (default ram)
+ *   -p PATH                   image/device for mmap, linux, uring
+ *   -m MB                     RAM disk size, or mmap image size to create (default 64)
+ *   -s SECTORS                record size in payload sectors (default 1)
+ *   -n COUNT                  records per workload (default 2000)
+ *   -r BYTES                  packed record size (default 40)
+ *   -c N                      group commit every N appends (default 1)
+ *   -w append|rle|cols|reserve|pack|msg|sb|ec|all  workload (default all)
+ *
+ * rle is append with storage_set_compression(STORAGE_COMPRESS_RLE); cols
+ * saves the same bytes as 4-channel int16 frames of a slow ramp through
+ * save_16bit_values(). ec is append on a 4+2 parity layout
+ * (storage_set_redundancy), compare sectors_written_per_rec with append;
+ * its parity is written once per commit, so use -c to see the saving.
+ *
+ * Prints one CSV row per workload so runs can be diffed across releases.
+ */
+
+driver_t *active_driver = &ram_driver;
+uint32_t log_sector = 0;  // global required by storage.c
+
+/* internal superblock accessors, see storage.c */
+uint8_t get_last_sector(uint64_t *last_sector);
+uint8_t set_last_sector(const uint64_t *last_sector);
+
+/* ---- Counting wrapper around the real driver ---- */
+typedef struct {
+    uint64_t read_calls, write_calls, sync_calls;
+    uint64_t sectors_read, sectors_written;
+} io_stats_t;
+
+static driver_t *inner;
+static io_stats_t stats;
+
+static int cnt_init(driver_t *self) {
+    int rc = inner->init(inner);
+    self->total_sectors = inner->total_sectors;
+    self->total_size_bytes = inner->total_size_bytes;
+    self->sector_size = inner->sector_size;
+    return rc;
+}
+static int cnt_read(driver_t *self, uint64_t lba, uint8_t *buf) {
+    (void)self; stats.read_calls++; stats.sectors_read++;
+    return inner->read_block(inner, lba, buf);
+}
+static int cnt_write(driver_t *self, uint64_t lba, const uint8_t *buf) {
+    (void)self; stats.write_calls++; stats.sectors_written++;
+    return inner->write_block(inner, lba, buf);
+}
+static int cnt_read_blocks(driver_t *self, uint64_t lba, uint32_t count, uint8_t *buf) {
+    (void)self; stats.read_calls++; stats.sectors_read += count;
+    return inner->read_blocks(inner, lba, count, buf);
+}
+static int cnt_write_blocks(driver_t *self, uint64_t lba, uint32_t count, const uint8_t *buf) {
+    (void)self; stats.write_calls++; stats.sectors_written += count;
+    return inner->write_blocks(inner, lba, count, buf);
+}
+static int cnt_write_batch(driver_t *self, const driver_write_t *reqs, uint32_t n, uint32_t flags) {
+    (void)self; stats.write_calls++;
+    for (uint32_t i = 0; i < n; i++) stats.sectors_written += reqs[i].count;
+    if (flags & DRIVER_BATCH_SYNC) stats.sync_calls++;
+    return inner->write_batch(inner, reqs, n, flags);
+}
+static int cnt_sync(driver_t *self) {
+    (void)self; stats.sync_calls++;
+    return inner->sync ? inner->sync(inner) : DRIVER_OK;
+}
+static void cnt_deinit(driver_t *self) {
+    (void)self;
+    inner->deinit(inner);
+}
+
+static driver_t count_driver;
+
+/* Only expose the optional ops the real driver has, so helper fallbacks stay honest */
+static void wrap_driver(driver_t *d) {
+    inner = d;
+    memset(&count_driver, 0, sizeof(count_driver));
+    count_driver.name = d->name;
+    count_driver.sector_size = d->sector_size;
+    count_driver.init = cnt_init;
+    count_driver.read_block = cnt_read;
+    count_driver.write_block = cnt_write;
+    count_driver.read_blocks = d->read_blocks ? cnt_read_blocks : NULL;
+    count_driver.write_blocks = d->write_blocks ? cnt_write_blocks : NULL;
+    count_driver.write_batch = d->write_batch ? cnt_write_batch : NULL;
+    count_driver.sync = cnt_sync;
+    count_driver.deinit = cnt_deinit;
+    active_driver = &count_driver;
+}
+
+/* ---- Timing ---- */
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(double *sorted, uint32_t n, double p) {
+    if (n == 0) return 0.0;
+    uint32_t i = (uint32_t)(p * (double)(n - 1) + 0.5);
+    return sorted[i];
+}
+
+typedef struct {
+    const char *workload;
+    uint32_t record_bytes;
+    uint32_t records;
+    double seconds;
+    double *lat;
+} result_t;
+
+static FILE *out;  // CSV sink; stdout carries the library's own chatter
+static const char *drv_name = "ram";
+static uint32_t commit_every = 1;
+
+static void report(const result_t *r) {
+    qsort(r->lat, r->records, sizeof(double), cmp_double);
+    double n = r->records ? (double)r->records : 1.0;
+    fprintf(out, "%s,%s,%u,%u,%u,%.6f,%.1f,%.3f,%.1f,%.1f,%.1f,%.3f,%.3f,%.3f,%.3f\n",
+           r->workload, drv_name, r->record_bytes, r->records, commit_every,
+           r->seconds,
+           r->records / r->seconds,
+           (double)r->record_bytes * r->records / r->seconds / 1e6,
+           percentile(r->lat, r->records, 0.50) * 1e6,
+           percentile(r->lat, r->records, 0.99) * 1e6,
+           percentile(r->lat, r->records, 0.999) * 1e6,
+           stats.read_calls / n, stats.write_calls / n,
+           stats.sectors_written / n, stats.sync_calls / n);
+}
+
+/* ---- Workloads ---- */
+static int bench_append(const char *name, uint8_t compress, uint32_t sectors, uint32_t count,
+                        double *lat) {
+    size_t len = (size_t)sectors * PAYLOAD_SIZE;
+    uint8_t *payload = malloc(len);
+    if (!payload) return 1;
+    for (size_t i = 0; i < len; i++) payload[i] = (uint8_t)(i * 7);
+    uint8_t header = 0xAB;
+
+    storage_commit_policy_t policy = { commit_every, 0, NULL };
+    storage_set_commit_policy(&policy);
+    storage_set_compression(compress);
+    if (init_log_sector() != STORAGE_OK) { free(payload); return 1; }
+
+    memset(&stats, 0, sizeof(stats));
+    double t0 = now_sec();
+    for (uint32_t i = 0; i < count; i++) {
+        double a = now_sec();
+        uint8_t rc = raid_u8bit_values(payload, len, &header);
+        if (rc != STORAGE_OK) {
+            fprintf(stderr, "%s %u failed (%u)\n", name, i, rc);
+            storage_set_compression(STORAGE_COMPRESS_OFF);
+            free(payload);
+            return 1;
+        }
+        lat[i] = now_sec() - a;
+    }
+    storage_set_compression(STORAGE_COMPRESS_OFF);
+    if (storage_flush() != STORAGE_OK) { free(payload); return 1; }
+    double t = now_sec() - t0;
+
+    result_t r = { name, (uint32_t)len, count, t, lat };
+    report(&r);
+    free(payload);
+    return 0;
+}
+
+static int bench_ec(uint32_t sectors, uint32_t count, double *lat) {
+    if (storage_set_redundancy(4, 2) != STORAGE_OK) return 1;
+    int rc = bench_append("ec", STORAGE_COMPRESS_OFF, sectors, count, lat);
+    storage_set_redundancy(0, 0);
+    return rc;
+}
+
+/* SECTORS * PAYLOAD_SIZE bytes of 4-channel int16 frames per append */
+static int bench_cols(uint32_t sectors, uint32_t count, double *lat) {
+    const uint8_t channels = 4;
+    uint32_t frames = (uint32_t)(sectors * PAYLOAD_SIZE / (2 * channels));
+    int16_t *samples = malloc((size_t)frames * channels * sizeof(*samples));
+    if (!samples) return 1;
+    uint8_t header = 0xAB;
+
+    storage_commit_policy_t policy = { commit_every, 0, NULL };
+    storage_set_commit_policy(&policy);
+    if (init_log_sector() != STORAGE_OK) { free(samples); return 1; }
+
+    memset(&stats, 0, sizeof(stats));
+    double t0 = now_sec();
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t f = 0; f < frames; f++)
+            for (uint8_t c = 0; c < channels; c++)
+                samples[f * channels + c] = (int16_t)((i * frames + f) / (c + 1) + (f & 1));
+        double a = now_sec();
+        uint8_t rc = save_16bit_values(samples, frames, channels, &header);
+        if (rc != STORAGE_OK) {
+            fprintf(stderr, "cols %u failed (%u)\n", i, rc);
+            free(samples);
+            return 1;
+        }
+        lat[i] = now_sec() - a;
+    }
+    if (storage_flush() != STORAGE_OK) { free(samples); return 1; }
+    double t = now_sec() - t0;
+
+    result_t r = { "cols", frames * channels * 2, count, t, lat };
+    report(&r);
+    free(samples);
+    return 0;
+}
+
+/* same appends through storage_reserve()/storage_commit(), filled in place */
+static int bench_reserve(uint32_t sectors, uint32_t count, double *lat) {
+    if (sectors > STORAGE_RESERVE_SECTORS) sectors = STORAGE_RESERVE_SECTORS;
+    uint8_t header = 0xAB;
+    storage_reservation_t resv;
+
+    storage_commit_policy_t policy = { commit_every, 0, NULL };
+    storage_set_commit_policy(&policy);
+    if (init_log_sector() != STORAGE_OK) return 1;
+
+    memset(&stats, 0, sizeof(stats));
+    double t0 = now_sec();
+    for (uint32_t i = 0; i < count; i++) {
+        double a = now_sec();
+        uint8_t rc = storage_reserve(sectors, &resv);
+        for (uint32_t s = 0; rc == STORAGE_OK && s < resv.count; s++)
+            memset(resv.payload + (size_t)s * resv.stride, (int)(i + s), PAYLOAD_SIZE);
+        if (rc == STORAGE_OK) rc = storage_commit(&header);
+        if (rc != STORAGE_OK) {
+            fprintf(stderr, "reserve %u failed (%u)\n", i, rc);
+            return 1;
+        }
+        lat[i] = now_sec() - a;
+    }
+    if (storage_flush() != STORAGE_OK) return 1;
+    double t = now_sec() - t0;
+
+    result_t r = { "reserve", sectors * PAYLOAD_SIZE, count, t, lat };
+    report(&r);
+    return 0;
+}
+
+/* small records through the packed stream, record i filled with (uint8_t)i */
+static int bench_pack(uint32_t rec_bytes, uint32_t count, double *lat) {
+    uint8_t rec[0xFFFF];
+    if (rec_bytes > sizeof(rec)) rec_bytes = sizeof(rec);
+
+    storage_commit_policy_t policy = { commit_every, 0, NULL };
+    storage_set_commit_policy(&policy);
+    if (init_log_sector() != STORAGE_OK) return 1;
+
+    memset(&stats, 0, sizeof(stats));
+    double t0 = now_sec();
+    for (uint32_t i = 0; i < count; i++) {
+        memset(rec, (int)i, rec_bytes);
+        double a = now_sec();
+        uint8_t rc = storage_pack_record((uint8_t)(1 + i % 200), rec, (uint16_t)rec_bytes);
+        if (rc != STORAGE_OK) {
+            fprintf(stderr, "pack %u failed (%u)\n", i, rc);
+            return 1;
+        }
+        lat[i] = now_sec() - a;
+    }
+    if (storage_flush() != STORAGE_OK) return 1;
+    double t = now_sec() - t0;
+
+    result_t r = { "pack", rec_bytes, count, t, lat };
+    report(&r);
+    return 0;
+}
+
+static int bench_msg(uint32_t count, double *lat) {
+    if (init_log_sector() != STORAGE_OK) return 1;
+
+    memset(&stats, 0, sizeof(stats));
+    double t0 = now_sec();
+    uint32_t done = 0;
+    for (; done < count; done++) {
+        uint8_t msg = (uint8_t)done;
+        double a = now_sec();
+        uint8_t rc = save_msg(&msg);
+        if (rc == STORAGE_ERR_LOG_FULL) break;  // one sector of messages
+        if (rc != STORAGE_OK) return 1;
+        lat[done] = now_sec() - a;
+    }
+    if (msg_flush() != STORAGE_OK) return 1;
+    double t = now_sec() - t0;
+
+    result_t r = { "msg", 1, done, t, lat };
+    report(&r);
+    return 0;
+}
+
+static int bench_superblock(uint32_t count, double *lat) {
+    if (init_log_sector() != STORAGE_OK) return 1;
+
+    /* commit: write every superblock mirror (synced batch) */
+    memset(&stats, 0, sizeof(stats));
+    double t0 = now_sec();
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t v = 1;
+        double a = now_sec();
+        if (set_last_sector(&v) != STORAGE_OK) return 1;
+        lat[i] = now_sec() - a;
+    }
+    result_t w = { "sb_commit", SECTOR_SIZE, count, now_sec() - t0, lat };
+    report(&w);
+
+    /* load: read + CRC + vote over every mirror */
+    memset(&stats, 0, sizeof(stats));
+    t0 = now_sec();
+    for (uint32_t i = 0; i < count; i++) {
+        double a = now_sec();
+        if (storage_revalidate() != STORAGE_OK) return 1;
+        lat[i] = now_sec() - a;
+    }
+    result_t l = { "sb_load", SECTOR_SIZE, count, now_sec() - t0, lat };
+    report(&l);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL;
+    const char *workload = "all";
+    uint64_t size_mb = 64;
+    uint32_t sectors = 1, count = 2000, rec_bytes = 40;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:p:m:s:n:r:c:w:")) != -1) {
+        switch (opt) {
+        case 'd': drv_name = optarg; break;
+        case 'p': path = optarg; break;
+        case 'm': size_mb = strtoull(optarg, NULL, 10); break;
+        case 's': sectors = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'n': count = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'r': rec_bytes = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'c': commit_every = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'w': workload = optarg; break;
+        default:
+            fprintf(stderr, "see the usage comment at the top of storage_bench.c\n");
+            return 1;
+        }
+    }
+    if (sectors == 0 || count == 0) return 1;
+    if (commit_every == 0) commit_every = 1;
+
+    driver_t *d = &ram_driver;
+    if (strcmp(drv_name, "ram") == 0) {
+        ram_driver_configure(NULL, size_mb * 1024u * 1024u);
+    } else if (strcmp(drv_name, "mmap") == 0 && path) {
+        mmap_driver_configure(path, size_mb * 1024u * 1024u);
+        d = &mmap_driver;
+    } else if (strcmp(drv_name, "linux") == 0 && path) {
+        linux_driver_set_path(path);
+        d = &linux_driver;
+    } else if (strcmp(drv_name, "uring") == 0 && path) {
+        uring_driver_set_path(path);
+        d = &uring_driver;
+    } else {
+        fprintf(stderr, "unknown driver '%s' or missing -p\n", drv_name);
+        return 1;
+    }
+    wrap_driver(d);
+
+    /* keep driver/storage chatter off the real stdout so the CSV stays clean */
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!out || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) return 1;
+
+    if (setup_storage() != STORAGE_OK) return 1;
+
+    uint64_t room = (RAID_OFFSET > 2) ? (RAID_OFFSET - 2) / sectors : 0;
+    if (count > room) {
+        fprintf(stderr, "clamping -n to %lu records to fit the device\n", (unsigned long)room);
+        count = (uint32_t)room;
+    }
+
+    double *lat = malloc(sizeof(double) * (count ? count : 1));
+    if (!lat) return 1;
+
+    fprintf(out, "workload,driver,record_bytes,records,commit_every,seconds,records_per_s,mb_per_s,"
+           "p50_us,p99_us,p999_us,reads_per_rec,writes_per_rec,sectors_written_per_rec,"
+           "syncs_per_rec\n");
+
+    int all = strcmp(workload, "all") == 0;
+    int fail = 0;
+    if (!fail && (all || strcmp(workload, "append") == 0))
+        fail |= bench_append("append", STORAGE_COMPRESS_OFF, sectors, count, lat);
+    if (!fail && (all || strcmp(workload, "rle") == 0))
+        fail |= bench_append("rle", STORAGE_COMPRESS_RLE, sectors, count, lat);
+    if (!fail && (all || strcmp(workload, "cols") == 0))
+        fail |= bench_cols(sectors, count, lat);
+    if (!fail && (all || strcmp(workload, "reserve") == 0))
+        fail |= bench_reserve(sectors, count, lat);
+    if (!fail && (all || strcmp(workload, "pack") == 0))
+        fail |= bench_pack(rec_bytes, count, lat);
+    if (!fail && (all || strcmp(workload, "msg") == 0))
+        fail |= bench_msg(count, lat);
+    if (!fail && (all || strcmp(workload, "sb") == 0))
+        fail |= bench_superblock(count, lat);
+    if (!fail && (all || strcmp(workload, "ec") == 0))
+        fail |= bench_ec(sectors, count, lat);
+
+    free(lat);
+    fclose(out);
+    active_driver->deinit(active_driver);
+    return fail;
+}
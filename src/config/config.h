@@ -3,11 +3,78 @@
 
 #include <stdint.h>
 
-extern const uint32_t SECTOR_SIZE;
-extern const uint32_t CRC_SIZE;
-extern const uint32_t HEADER_SIZE;
-extern const uint32_t PAYLOAD_SIZE;
-extern const uint32_t RAID_MIRRORS;
-extern uint32_t RAID_OFFSET;
+/* ---- Storage profiles ----
+ * Everything that fixes the on-card layout or a buffer size is a
+ * compile-time constant chosen by profile, so buffers are plain arrays
+ * and loop bounds fold. Pick one with -DSTORAGE_PROFILE=... (the
+ * Makefiles take PROFILE=SAMD21_SD_512 etc.); the firmware and the reader
+ * that reads its cards must be built with profiles of the same layout.
+ *
+ *   SAMD21_SD_512  SD card over SPI, 512-byte sectors, a few KiB of stack
+ *   HOST_512       Linux / RAM drivers, same card layout (default)
+ *   HOST_4K        host images with 4 KiB sectors
+ *
+ * SECTOR_SIZE is the logical block the format works in, recorded in the
+ * superblock. -DSTORAGE_BLOCK_SIZE=1024 (make BLOCK=1024) overrides the
+ * profile's; drivers split a block into device sectors as needed.
+ */
+#define STORAGE_PROFILE_SAMD21_SD_512 1
+#define STORAGE_PROFILE_HOST_512 2
+#define STORAGE_PROFILE_HOST_4K 3
+
+#ifndef STORAGE_PROFILE
+#define STORAGE_PROFILE STORAGE_PROFILE_HOST_512
+#endif
+
+#if STORAGE_PROFILE == STORAGE_PROFILE_SAMD21_SD_512
+#define STORAGE_PROFILE_NAME "SAMD21-SD-512"
+#define SECTOR_SIZE_DEFAULT 512u
+#define RAID_MIRRORS 3u
+#define STORAGE_IO_SECTORS 2
+#define STORAGE_RESERVE_SECTORS 2
+#elif STORAGE_PROFILE == STORAGE_PROFILE_HOST_512
+#define STORAGE_PROFILE_NAME "host-512"
+#define SECTOR_SIZE_DEFAULT 512u
+#define RAID_MIRRORS 3u
+#define STORAGE_IO_SECTORS 8
+#define STORAGE_RESERVE_SECTORS 8
+#elif STORAGE_PROFILE == STORAGE_PROFILE_HOST_4K
+#define STORAGE_PROFILE_NAME "host-4K"
+#define SECTOR_SIZE_DEFAULT 4096u
+#define RAID_MIRRORS 3u
+#define STORAGE_IO_SECTORS 8
+#define STORAGE_RESERVE_SECTORS 8
+#else
+#error "unknown STORAGE_PROFILE"
+#endif
+
+#ifdef STORAGE_BLOCK_SIZE
+#define SECTOR_SIZE STORAGE_BLOCK_SIZE
+#else
+#define SECTOR_SIZE SECTOR_SIZE_DEFAULT
+#endif
+
+/* Largest logical block any card can use, sizes the reader's buffers */
+#define STORAGE_BLOCK_MAX 4096u
+
+/* Sector layout: [header][payload][CRC] */
+#define CRC_SIZE 4u
+#define HEADER_SIZE 1u
+#define PAYLOAD_SIZE (SECTOR_SIZE - CRC_SIZE - HEADER_SIZE)
+
+/* Logical sectors scrubbed between forced writes of the scrub cursor */
+#ifndef STORAGE_SCRUB_PERSIST
+#define STORAGE_SCRUB_PERSIST 1024
+#endif
+
+#if SECTOR_SIZE < 512 || SECTOR_SIZE > STORAGE_BLOCK_MAX || (SECTOR_SIZE & (SECTOR_SIZE - 1))
+#error "SECTOR_SIZE must be a power of two from 512 to 4096"
+#endif
+#if RAID_MIRRORS < 1 || RAID_MIRRORS > 8
+#error "RAID_MIRRORS must be 1..8"
+#endif
+
+/* Mirror slice size in sectors, set from the device size at setup */
+extern uint64_t RAID_OFFSET;
 
 #endif /* CONFIG_H */
@@ -0,0 +1,98 @@
+#include "codec.h"
+
+#include <string.h>
+
+#define RUN_MIN 3
+#define RUN_MAX 130
+#define LIT_MAX 128
+
+static uint8_t filtered(const uint8_t *in, size_t i, uint8_t mode) {
+    if (mode != CODEC_MODE_DELTA) return in[i];
+    return (uint8_t)(in[i] - (i ? in[i - 1] : 0));
+}
+
+/* Emit in[from, to) as literals, at most LIT_MAX per token; 0 if out of room */
+static int put_literals(const uint8_t *in, size_t from, size_t to, uint8_t mode,
+                        uint8_t *out, size_t *o, size_t cap) {
+    while (from < to) {
+        size_t k = to - from;
+        if (k > LIT_MAX) k = LIT_MAX;
+        if (*o + 1 + k > cap) return 0;
+        out[(*o)++] = (uint8_t)(k - 1);
+        for (size_t j = 0; j < k; j++) out[(*o)++] = filtered(in, from + j, mode);
+        from += k;
+    }
+    return 1;
+}
+
+size_t codec_encode(const uint8_t *in, size_t n, uint8_t *out, size_t cap, uint8_t mode) {
+    size_t o = 0, i = 0, lit = 0;   // lit: start of the pending literal
+
+    while (i < n) {
+        uint8_t b = filtered(in, i, mode);
+        size_t run = 1;
+        while (i + run < n && run < RUN_MAX && filtered(in, i + run, mode) == b) run++;
+
+        if (run < RUN_MIN) {
+            i += run;
+            if (i - lit >= LIT_MAX) {
+                if (!put_literals(in, lit, lit + LIT_MAX, mode, out, &o, cap)) return 0;
+                lit += LIT_MAX;
+            }
+            continue;
+        }
+
+        if (!put_literals(in, lit, i, mode, out, &o, cap)) return 0;
+        if (o + 2 > cap) return 0;
+        out[o++] = (uint8_t)(0x80 + run - RUN_MIN);
+        out[o++] = b;
+        i += run;
+        lit = i;
+    }
+    if (!put_literals(in, lit, n, mode, out, &o, cap)) return 0;
+    return o;
+}
+
+size_t codec_decode(const uint8_t *in, size_t in_len, uint8_t *out, size_t n, uint8_t mode) {
+    size_t p = 0, o = 0;
+
+    while (o < n) {
+        if (p >= in_len) return 0;
+        uint8_t ctrl = in[p++];
+        if (ctrl < 0x80) {
+            size_t k = (size_t)ctrl + 1;
+            if (p + k > in_len || o + k > n) return 0;
+            memcpy(out + o, in + p, k);
+            p += k;
+            o += k;
+        } else {
+            size_t k = (size_t)(ctrl - 0x80) + RUN_MIN;
+            if (p >= in_len || o + k > n) return 0;
+            memset(out + o, in[p++], k);
+            o += k;
+        }
+    }
+
+    if (mode == CODEC_MODE_DELTA)
+        for (size_t i = 1; i < n; i++) out[i] = (uint8_t)(out[i] + out[i - 1]);
+    return p;
+}
+
+int codec_sector_decode(const uint8_t *payload, size_t payload_size, size_t record_len,
+                        uint8_t *out, uint32_t max_records, uint8_t *header) {
+    if (payload_size < 2) return -1;
+    uint32_t k = payload[1];
+    size_t p = 2;
+
+    if (header) *header = payload[0];
+    if (k > max_records) return -1;
+    for (uint32_t r = 0; r < k; r++) {
+        if (p >= payload_size) return -1;
+        uint8_t mode = payload[p++];
+        size_t used = codec_decode(payload + p, payload_size - p, out + r * record_len,
+                                   record_len, mode);
+        if (!used) return -1;
+        p += used;
+    }
+    return (int)k;
+}
@@ -0,0 +1,33 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Byte RLE with an optional delta pre-filter, PackBits style:
+ *   0x00..0x7F  literal, ctrl + 1 bytes follow
+ *   0x80..0xFF  run, the next byte repeated (ctrl - 0x80) + 3 times
+ * With delta, byte i is stored as in[i] - in[i-1] (in[-1] = 0), which
+ * turns slow ramps into runs. The worst case is one extra byte per 128.
+ */
+#define CODEC_MODE_RLE 0
+#define CODEC_MODE_DELTA 1
+#define CODEC_BOUND(n) ((n) + ((n) + 127) / 128)
+
+/* Encoded size, or 0 if it does not fit in cap */
+size_t codec_encode(const uint8_t *in, size_t n, uint8_t *out, size_t cap, uint8_t mode);
+
+/* Decode exactly n bytes; returns encoded bytes consumed, or 0 on malformed input */
+size_t codec_decode(const uint8_t *in, size_t in_len, uint8_t *out, size_t n, uint8_t mode);
+
+/*
+ * Compressed data sectors (STORAGE_SECTOR_RLE) hold whole records:
+ *   payload = [u8 user header][u8 k][k x ([u8 mode][encoded record])]
+ * Decodes up to max_records records of record_len bytes into out.
+ * Returns the number of records, or -1 if the sector is malformed.
+ */
+int codec_sector_decode(const uint8_t *payload, size_t payload_size, size_t record_len,
+                        uint8_t *out, uint32_t max_records, uint8_t *header);
+
+#endif /* CODEC_H */
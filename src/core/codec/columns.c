@@ -0,0 +1,371 @@
+#include "columns.h"
+
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define COLUMNS_HAVE_SIMD 1
+#include <immintrin.h>
+#else
+#define COLUMNS_HAVE_SIMD 0
+#endif
+
+static uint32_t sample(const void *buf, uint8_t type, size_t i) {
+    switch (type) {
+    case 2: return ((const uint16_t *)buf)[i];
+    case 2 | COLUMNS_SIGNED: return (uint32_t)(int32_t)((const int16_t *)buf)[i];
+    default: return ((const uint32_t *)buf)[i];
+    }
+}
+
+static uint32_t zigzag(uint32_t v) {
+    return (v << 1) ^ (uint32_t)-(v >> 31);
+}
+
+static uint8_t bit_length(uint32_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return v ? (uint8_t)(32 - __builtin_clz(v)) : 0;
+#else
+    uint8_t n = 0;
+    while (v) {
+        n++;
+        v >>= 1;
+    }
+    return n;
+#endif
+}
+
+static size_t packed_bytes(uint32_t n, uint8_t bits) {
+    return n ? ((size_t)(n - 1) * bits + 7) / 8 : 0;
+}
+
+/* Residual of frame f >= 1 in mode, given the previous value and delta */
+static uint32_t residual(uint8_t mode, uint32_t f, uint32_t x, uint32_t prev, uint32_t prev_d) {
+    uint32_t d = x - prev;
+    switch (mode) {
+    case COLUMNS_RAW: return zigzag(x);
+    case COLUMNS_DOD: return zigzag(f == 1 ? d : d - prev_d);
+    default: return zigzag(d);
+    }
+}
+
+/* Cheapest mode for the OR of each mode's residuals (same bit length as the max) */
+static uint8_t best_mode(const uint32_t *widest, uint8_t *bits) {
+    uint8_t mode = COLUMNS_DELTA;
+    *bits = bit_length(widest[COLUMNS_DELTA]);
+    for (uint8_t m = COLUMNS_DELTA + 1; m < COLUMNS_MODES; m++) {
+        if (bit_length(widest[m]) < *bits) {
+            mode = m;
+            *bits = bit_length(widest[m]);
+        }
+    }
+    return mode;
+}
+
+uint32_t columns_fit(const void *buf, uint8_t type, uint32_t frames, uint8_t channels,
+                     uint32_t start, size_t cap) {
+    uint32_t widest[COLUMNS_CHANNELS_MAX][COLUMNS_MODES];
+    uint32_t prev[COLUMNS_CHANNELS_MAX], prev_d[COLUMNS_CHANNELS_MAX];
+    uint32_t n = 0;
+
+    if (channels == 0 || channels > COLUMNS_CHANNELS_MAX) return 0;
+    if (COLUMNS_HDR + (size_t)channels * COLUMNS_CH_HDR > cap) return 0;
+    memset(widest, 0, sizeof(widest));
+
+    for (; start + n < frames && n < COLUMNS_FRAMES_MAX; n++) {
+        uint32_t next[COLUMNS_CHANNELS_MAX][COLUMNS_MODES];
+        uint32_t x[COLUMNS_CHANNELS_MAX];
+        size_t size = COLUMNS_HDR;
+        for (uint8_t c = 0; c < channels; c++) {
+            x[c] = sample(buf, type, (size_t)(start + n) * channels + c);
+            for (uint8_t m = 0; m < COLUMNS_MODES; m++)
+                next[c][m] = widest[c][m] | (n ? residual(m, n, x[c], prev[c], prev_d[c]) : 0);
+            uint8_t bits;
+            best_mode(next[c], &bits);
+            size += COLUMNS_CH_HDR + packed_bytes(n + 1, bits);
+        }
+        if (size > cap) break;
+
+        for (uint8_t c = 0; c < channels; c++) {
+            prev_d[c] = n ? x[c] - prev[c] : 0;
+            prev[c] = x[c];
+            memcpy(widest[c], next[c], sizeof(next[c]));
+        }
+    }
+    return n;
+}
+
+size_t columns_encode(const void *buf, uint8_t type, uint8_t channels, uint32_t start,
+                      uint32_t n, uint8_t header, uint8_t *out, size_t cap) {
+    size_t o = COLUMNS_HDR;
+
+    memset(out, 0, cap);
+    out[0] = header;
+    out[1] = type;
+    out[2] = channels;
+    out[3] = (uint8_t)n;
+    out[4] = (uint8_t)(n >> 8);
+
+    for (uint8_t c = 0; c < channels; c++) {
+        uint32_t widest[COLUMNS_MODES] = { 0 };
+        uint32_t first = sample(buf, type, (size_t)start * channels + c);
+        uint32_t prev = first, prev_d = 0;
+        for (uint32_t f = 1; f < n; f++) {
+            uint32_t x = sample(buf, type, (size_t)(start + f) * channels + c);
+            for (uint8_t m = 0; m < COLUMNS_MODES; m++)
+                widest[m] |= residual(m, f, x, prev, prev_d);
+            prev_d = x - prev;
+            prev = x;
+        }
+        uint8_t bits;
+        uint8_t mode = best_mode(widest, &bits);
+
+        prev = first;
+        prev_d = 0;
+        out[o++] = mode;
+        out[o++] = bits;
+        for (int k = 0; k < 4; k++) out[o++] = (uint8_t)(prev >> (8 * k));
+
+        uint64_t acc = 0;
+        uint8_t fill = 0;
+        for (uint32_t f = 1; f < n; f++) {
+            uint32_t x = sample(buf, type, (size_t)(start + f) * channels + c);
+            acc |= (uint64_t)residual(mode, f, x, prev, prev_d) << fill;
+            fill += bits;
+            while (fill >= 8) {
+                out[o++] = (uint8_t)acc;
+                acc >>= 8;
+                fill -= 8;
+            }
+            prev_d = x - prev;
+            prev = x;
+        }
+        if (fill) out[o++] = (uint8_t)acc;
+    }
+    return o;
+}
+
+#if COLUMNS_HAVE_SIMD
+/* ---- Reconstruction kernels ----
+ * v holds n zigzag residuals of one channel and is rebuilt in place into
+ * values. x is the value before v[0], d the delta before it (DOD only).
+ * DELTA is one running sum, DOD two (the first DOD residual is a plain
+ * delta, which is a running sum from d = 0). */
+
+static void rebuild_scalar(uint32_t *v, uint32_t n, uint8_t mode, uint32_t x, uint32_t d) {
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t r = (v[i] >> 1) ^ (uint32_t)-(v[i] & 1);
+        if (mode == COLUMNS_RAW) {
+            x = r;
+        } else if (mode == COLUMNS_DOD) {
+            d += r;
+            x += d;
+        } else {
+            x += r;
+        }
+        v[i] = x;
+    }
+}
+
+static __m128i unzigzag_sse2(__m128i z) {
+    __m128i sign = _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(z, _mm_set1_epi32(1)));
+    return _mm_xor_si128(_mm_srli_epi32(z, 1), sign);
+}
+
+/* inclusive prefix sum of 4 lanes */
+static __m128i scan_sse2(__m128i v) {
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+    return _mm_add_epi32(v, _mm_slli_si128(v, 8));
+}
+
+static void rebuild_sse2(uint32_t *v, uint32_t n, uint8_t mode, uint32_t x, uint32_t d) {
+    __m128i carry = _mm_set1_epi32((int32_t)x), dcarry = _mm_set1_epi32((int32_t)d);
+    uint32_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i r = unzigzag_sse2(_mm_loadu_si128((const __m128i *)(v + i)));
+        if (mode == COLUMNS_DOD) {
+            r = _mm_add_epi32(scan_sse2(r), dcarry);
+            dcarry = _mm_shuffle_epi32(r, 0xFF);
+        }
+        if (mode != COLUMNS_RAW) {
+            r = _mm_add_epi32(scan_sse2(r), carry);
+            carry = _mm_shuffle_epi32(r, 0xFF);
+        }
+        _mm_storeu_si128((__m128i *)(v + i), r);
+    }
+    if (i < n)
+        rebuild_scalar(v + i, n - i, mode, (uint32_t)_mm_cvtsi128_si32(carry),
+                       (uint32_t)_mm_cvtsi128_si32(dcarry));
+}
+
+__attribute__((target("avx2")))
+static __m256i unzigzag_avx2(__m256i z) {
+    __m256i sign = _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_and_si256(z, _mm256_set1_epi32(1)));
+    return _mm256_xor_si256(_mm256_srli_epi32(z, 1), sign);
+}
+
+/* inclusive prefix sum of 8 lanes: scan each 128-bit half, then carry
+ * the low half's total into the high half */
+__attribute__((target("avx2")))
+static __m256i scan_avx2(__m256i v) {
+    v = _mm256_add_epi32(v, _mm256_slli_si256(v, 4));
+    v = _mm256_add_epi32(v, _mm256_slli_si256(v, 8));
+    __m256i low = _mm256_shuffle_epi32(v, 0xFF);
+    return _mm256_add_epi32(v, _mm256_permute2x128_si256(low, low, 0x08));
+}
+
+__attribute__((target("avx2")))
+static void rebuild_avx2(uint32_t *v, uint32_t n, uint8_t mode, uint32_t x, uint32_t d) {
+    const __m256i last = _mm256_set1_epi32(7);
+    __m256i carry = _mm256_set1_epi32((int32_t)x), dcarry = _mm256_set1_epi32((int32_t)d);
+    uint32_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i r = unzigzag_avx2(_mm256_loadu_si256((const __m256i *)(v + i)));
+        if (mode == COLUMNS_DOD) {
+            r = _mm256_add_epi32(scan_avx2(r), dcarry);
+            dcarry = _mm256_permutevar8x32_epi32(r, last);
+        }
+        if (mode != COLUMNS_RAW) {
+            r = _mm256_add_epi32(scan_avx2(r), carry);
+            carry = _mm256_permutevar8x32_epi32(r, last);
+        }
+        _mm256_storeu_si256((__m256i *)(v + i), r);
+    }
+    if (i < n)
+        rebuild_scalar(v + i, n - i, mode, (uint32_t)_mm256_cvtsi256_si32(carry),
+                       (uint32_t)_mm256_cvtsi256_si32(dcarry));
+}
+
+/* 8 values per gather: a 4-byte load at each value's first byte covers
+ * shift (< 8) + bits, so this needs bits <= 25 */
+__attribute__((target("avx2")))
+static uint32_t unpack_avx2(const uint8_t *pad, uint8_t bits, uint32_t *out, uint32_t n) {
+    const __m256i mask = _mm256_set1_epi32((int32_t)((1u << bits) - 1));
+    const __m256i step = _mm256_set1_epi32(8 * bits);
+    const __m256i seven = _mm256_set1_epi32(7);
+    __m256i pos = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                     _mm256_set1_epi32(bits));
+    uint32_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i w = _mm256_i32gather_epi32((const int *)pad, _mm256_srli_epi32(pos, 3), 1);
+        w = _mm256_srlv_epi32(w, _mm256_and_si256(pos, seven));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_and_si256(w, mask));
+        pos = _mm256_add_epi32(pos, step);
+    }
+    return i;
+}
+
+/* n values of bits each, LSB first; src is copied so the wide loads
+ * never run past the payload */
+static void unpack(const uint8_t *src, size_t nbytes, uint8_t bits, uint32_t *out, uint32_t n, int level) {
+    uint8_t pad[COLUMNS_FRAMES_MAX * 4 + 8];
+    const uint64_t mask = (bits == 32) ? 0xFFFFFFFFu : ((1u << bits) - 1);
+    uint32_t i = 0;
+
+    if (bits == 0) {
+        memset(out, 0, (size_t)n * sizeof(*out));
+        return;
+    }
+    memcpy(pad, src, nbytes);
+    memset(pad + nbytes, 0, 8);
+    if (level == 2 && bits <= 25) i = unpack_avx2(pad, bits, out, n);
+    for (; i < n; i++) {
+        size_t pos = (size_t)i * bits;
+        const uint8_t *p = pad + (pos >> 3);
+        uint64_t w = (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) |
+                     ((uint64_t)p[3] << 24) | ((uint64_t)p[4] << 32);
+        out[i] = (uint32_t)((w >> (pos & 7)) & mask);
+    }
+}
+
+
+static void decode_simd(const uint8_t *p, size_t nbytes, uint8_t mode, uint8_t bits, uint32_t x,
+                        uint32_t *col, uint32_t n, int level) {
+    unpack(p, nbytes, bits, col + 1, n - 1, level);
+    if (level == 2) rebuild_avx2(col + 1, n - 1, mode, x, 0);
+    else rebuild_sse2(col + 1, n - 1, mode, x, 0);
+}
+#endif
+
+/* One channel's residuals, streamed: the fallback without SIMD */
+static void decode_scalar(const uint8_t *p, uint8_t mode, uint8_t bits, uint32_t x,
+                          uint32_t *col, uint32_t n) {
+    uint64_t acc = 0;
+    uint8_t fill = 0;
+    uint32_t d = 0;
+    uint64_t mask = (bits == 32) ? 0xFFFFFFFFu : ((1u << bits) - 1);
+    for (uint32_t f = 1; f < n; f++) {
+        while (fill < bits) {
+            acc |= (uint64_t)*p++ << fill;
+            fill += 8;
+        }
+        uint32_t z = (uint32_t)(acc & mask);
+        acc >>= bits;
+        fill -= bits;
+        uint32_t r = (z >> 1) ^ (uint32_t)-(z & 1);
+        if (mode == COLUMNS_RAW) {
+            x = r;
+        } else {
+            d = (mode == COLUMNS_DOD && f > 1) ? d + r : r;
+            x += d;
+        }
+        col[f] = x;
+    }
+}
+
+static int simd_cap = 2;
+
+void columns_set_simd(uint8_t level) {
+    simd_cap = level;
+}
+
+#if COLUMNS_HAVE_SIMD
+static int simd_cpu = -1;   // 0 scalar, 1 SSE2, 2 AVX2
+
+static int simd_level(void) {
+    if (simd_cpu < 0) simd_cpu = __builtin_cpu_supports("avx2") ? 2 : 1;
+    return simd_cpu < simd_cap ? simd_cpu : simd_cap;
+}
+#endif
+
+int columns_decode(const uint8_t *payload, size_t payload_size, int32_t *out, size_t max_values,
+                   uint8_t *type, uint8_t *channels, uint8_t *header) {
+    if (payload_size < COLUMNS_HDR) return -1;
+    uint8_t ch = payload[2];
+    uint32_t n = payload[3] | (payload[4] << 8);
+    size_t p = COLUMNS_HDR;
+
+    uint8_t width = payload[1] & ~COLUMNS_SIGNED;
+
+    if (width != 2 && width != 4) return -1;
+    if (ch == 0 || ch > COLUMNS_CHANNELS_MAX || n == 0 || n > COLUMNS_FRAMES_MAX) return -1;
+    if ((size_t)ch * n > max_values) return -1;
+
+    for (uint8_t c = 0; c < ch; c++) {
+        if (p + COLUMNS_CH_HDR > payload_size) return -1;
+        uint8_t mode = payload[p], bits = payload[p + 1];
+        if (mode >= COLUMNS_MODES || bits > 32) return -1;
+        uint32_t x = (uint32_t)payload[p + 2] | ((uint32_t)payload[p + 3] << 8) |
+                     ((uint32_t)payload[p + 4] << 16) | ((uint32_t)payload[p + 5] << 24);
+        size_t nbytes = packed_bytes(n, bits);
+        p += COLUMNS_CH_HDR;
+        if (p + nbytes > payload_size) return -1;
+
+        uint32_t *col = (uint32_t *)(out + (size_t)c * n);
+        col[0] = x;
+#if COLUMNS_HAVE_SIMD
+        int level = simd_level();
+        if (level) decode_simd(payload + p, nbytes, mode, bits, x, col, n, level);
+        else
+#endif
+        decode_scalar(payload + p, mode, bits, x, col, n);
+        p += nbytes;
+    }
+
+    if (type) *type = payload[1];
+    if (channels) *channels = ch;
+    if (header) *header = payload[0];
+    return (int)n;
+}
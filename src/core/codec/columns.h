@@ -0,0 +1,55 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Column-wise integer sectors (STORAGE_SECTOR_COLUMNS). Input is frames
+ * of interleaved channels, as an ADC scan delivers them; each sector
+ * stores a run of frames one channel after the other:
+ *   payload = [u8 user header][u8 type][u8 channels][u16 frames]
+ *             channels x [u8 mode][u8 bits][i32 first][residuals]
+ * type is the sample width in bytes, or'ed with COLUMNS_SIGNED. Samples
+ * are widened to 32 bits and residuals taken modulo 2^32: with
+ * COLUMNS_DELTA x[i] - x[i-1], with COLUMNS_DOD the change of that delta
+ * (the first residual is a plain delta), with COLUMNS_RAW x[i] itself for
+ * noise that deltas only widen. Residuals are zigzag coded and
+ * bit-packed LSB first at bits each, frames - 1 of them, padded to a byte.
+ * Everything is little-endian. Each channel picks its cheapest mode.
+ */
+#define COLUMNS_DELTA 0
+#define COLUMNS_DOD 1
+#define COLUMNS_RAW 2
+#define COLUMNS_MODES 3
+#define COLUMNS_SIGNED 0x80
+#define COLUMNS_HDR 5
+#define COLUMNS_CH_HDR 6
+#define COLUMNS_CHANNELS_MAX 32
+#define COLUMNS_FRAMES_MAX 1024
+
+/* Frames from start (at most COLUMNS_FRAMES_MAX) that encode into cap bytes */
+uint32_t columns_fit(const void *buf, uint8_t type, uint32_t frames, uint8_t channels,
+                     uint32_t start, size_t cap);
+
+/* Encode n frames from start into out (cap bytes, zero padded); returns bytes used */
+size_t columns_encode(const void *buf, uint8_t type, uint8_t channels, uint32_t start,
+                      uint32_t n, uint8_t header, uint8_t *out, size_t cap);
+
+/*
+ * Decode a sector into out, one column of frames values per channel
+ * (channel c starts at out + c * frames). Returns frames, or -1 if the
+ * sector is malformed or would need more than max_values values.
+ * type, channels and header (any may be NULL) describe the sector.
+ */
+int columns_decode(const uint8_t *payload, size_t payload_size, int32_t *out, size_t max_values,
+                   uint8_t *type, uint8_t *channels, uint8_t *header);
+
+/*
+ * columns_decode() unpacks and rebuilds with SSE2/AVX2 on x86-64 where the
+ * CPU has it, else streams each channel scalar. Caps the kernel at level
+ * (0 scalar, 1 SSE2, 2 AVX2), e.g. to check one against the other.
+ */
+void columns_set_simd(uint8_t level);
+
+#endif /* COLUMNS_H */
@@ -0,0 +1,121 @@
+#include "erasure.h"
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define EC_HAVE_SIMD 1
+#include <immintrin.h>
+#else
+#define EC_HAVE_SIMD 0
+#endif
+
+static uint8_t gf_exp[510];
+static uint8_t gf_log[256];
+static uint8_t gf_ready = 0;
+static int simd = 0;   // 0 scalar, 1 SSSE3, 2 AVX2
+
+void ec_init(void) {
+    uint16_t x = 1;
+    if (gf_ready) return;
+    for (uint16_t i = 0; i < 255; i++) {
+        gf_exp[i] = gf_exp[i + 255] = (uint8_t)x;
+        gf_log[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100) x ^= 0x11D;
+    }
+#if EC_HAVE_SIMD
+    simd = __builtin_cpu_supports("avx2") ? 2 : __builtin_cpu_supports("ssse3") ? 1 : 0;
+#endif
+    gf_ready = 1;
+}
+
+uint8_t gf_mul(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) return 0;
+    return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+uint8_t gf_inv(uint8_t a) {
+    return gf_exp[255 - gf_log[a]];
+}
+
+uint8_t ec_coef(uint8_t j, uint8_t i) {
+    return j == 0 ? 1 : gf_exp[i];
+}
+
+/* ---- Region kernels: c * x = lo[x & 15] ^ hi[x >> 4] ---- */
+
+static void mul_add_scalar(uint8_t *dst, const uint8_t *src, size_t n,
+                           const uint8_t *lo, const uint8_t *hi) {
+    for (size_t i = 0; i < n; i++)
+        dst[i] ^= lo[src[i] & 15] ^ hi[src[i] >> 4];
+}
+
+#if EC_HAVE_SIMD
+__attribute__((target("ssse3")))
+static size_t mul_add_ssse3(uint8_t *dst, const uint8_t *src, size_t n,
+                            const uint8_t *lo, const uint8_t *hi) {
+    const __m128i tlo = _mm_loadu_si128((const __m128i *)lo);
+    const __m128i thi = _mm_loadu_si128((const __m128i *)hi);
+    const __m128i mask = _mm_set1_epi8(15);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i p = _mm_xor_si128(_mm_shuffle_epi8(tlo, _mm_and_si128(s, mask)),
+                                  _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi64(s, 4), mask)));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(d, p));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t mul_add_avx2(uint8_t *dst, const uint8_t *src, size_t n,
+                           const uint8_t *lo, const uint8_t *hi) {
+    const __m256i tlo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)lo));
+    const __m256i thi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)hi));
+    const __m256i mask = _mm256_set1_epi8(15);
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i p = _mm256_xor_si256(
+            _mm256_shuffle_epi8(tlo, _mm256_and_si256(s, mask)),
+            _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask)));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(d, p));
+    }
+    return i;
+}
+#endif
+
+void ec_mul_add(uint8_t *dst, const uint8_t *src, size_t n, uint8_t c) {
+    uint8_t lo[16], hi[16];
+    size_t i = 0;
+
+    if (c == 0) return;
+    for (uint8_t x = 0; x < 16; x++) {
+        lo[x] = gf_mul(c, x);
+        hi[x] = gf_mul(c, (uint8_t)(x << 4));
+    }
+#if EC_HAVE_SIMD
+    if (simd == 2) i = mul_add_avx2(dst, src, n, lo, hi);
+    else if (simd == 1) i = mul_add_ssse3(dst, src, n, lo, hi);
+#endif
+    mul_add_scalar(dst + i, src + i, n - i, lo, hi);
+}
+
+void ec_solve(uint8_t *out, const uint8_t *const *syn, const uint8_t *rows,
+              const uint8_t *cols, uint8_t e, uint8_t want, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = 0;
+
+    if (e == 1) {
+        ec_mul_add(out, syn[0], n, gf_inv(ec_coef(rows[0], cols[0])));
+        return;
+    }
+
+    // 2x2: [a b; c d]^-1 = [d b; c a] / det, minus is plus in GF(2^8)
+    uint8_t a = ec_coef(rows[0], cols[0]), b = ec_coef(rows[0], cols[1]);
+    uint8_t c = ec_coef(rows[1], cols[0]), d = ec_coef(rows[1], cols[1]);
+    uint8_t inv = gf_inv(gf_mul(a, d) ^ gf_mul(b, c));
+    ec_mul_add(out, syn[0], n, gf_mul(want ? c : d, inv));
+    ec_mul_add(out, syn[1], n, gf_mul(want ? a : b, inv));
+}
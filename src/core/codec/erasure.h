@@ -0,0 +1,40 @@
+#ifndef ERASURE_H
+#define ERASURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Erasure code over GF(2^8) (polynomial 0x11D) for groups of k data
+ * sectors and m parity sectors. Parity row 0 is the XOR of the data
+ * (P), row 1 sums 2^i * d_i (Q, as in RAID-6), so any k of the k + m
+ * sectors rebuild the rest for k <= EC_DATA_MAX.
+ */
+#define EC_DATA_MAX 6
+#define EC_PARITY_MAX 2
+
+/*
+ * Builds the GF tables and picks the region kernel. Call it once before
+ * anything below, and before starting threads that use them.
+ */
+void ec_init(void);
+
+uint8_t gf_mul(uint8_t a, uint8_t b);
+uint8_t gf_inv(uint8_t a);   // a != 0
+
+/* Coefficient of data column i in parity row j */
+uint8_t ec_coef(uint8_t j, uint8_t i);
+
+/* dst ^= c * src over n bytes (SSSE3/AVX2 nibble tables where the CPU has them) */
+void ec_mul_add(uint8_t *dst, const uint8_t *src, size_t n, uint8_t c);
+
+/*
+ * Rebuild column cols[want] of a group missing the e <= EC_PARITY_MAX
+ * data columns cols[0..e-1]. syn[r] is parity row rows[r] with every
+ * surviving column's share already added out (ec_mul_add with
+ * ec_coef(rows[r], i)). out gets n bytes.
+ */
+void ec_solve(uint8_t *out, const uint8_t *const *syn, const uint8_t *rows,
+              const uint8_t *cols, uint8_t e, uint8_t want, size_t n);
+
+#endif /* ERASURE_H */
@@ -0,0 +1,271 @@
+#include "crc32.h"
+
+#define CRC32_POLY 0xEDB88320u
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32_HAVE_PCLMUL 1
+#include <immintrin.h>
+#else
+#define CRC32_HAVE_PCLMUL 0
+#endif
+
+/* All backends work on the raw (pre-inverted) register value. */
+typedef uint32_t (*crc32_fn_t)(uint32_t crc, const uint8_t *p, size_t len);
+
+#ifdef CRC32_NO_SLICE8
+static uint32_t crc_table[1][256];
+#else
+static uint32_t crc_table[8][256];
+#endif
+static uint8_t crc_table_ready = 0;
+
+static crc32_backend_t crc_backend = CRC32_BACKEND_AUTO;
+static crc32_fn_t crc_impl = 0;
+
+static void crc32_build_tables(void) {
+    if (crc_table_ready) return;
+
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int j = 0; j < 8; j++)
+            c = (c & 1) ? (c >> 1) ^ CRC32_POLY : (c >> 1);
+        crc_table[0][i] = c;
+    }
+#ifndef CRC32_NO_SLICE8
+    for (uint32_t i = 0; i < 256; i++)
+        for (int k = 1; k < 8; k++)
+            crc_table[k][i] = (crc_table[k - 1][i] >> 8)
+                            ^ crc_table[0][crc_table[k - 1][i] & 0xFF];
+#endif
+    crc_table_ready = 1;
+}
+
+/* ---- Backends ---- */
+
+static uint32_t crc32_bitwise(uint32_t crc, const uint8_t *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int j = 0; j < 8; j++) {
+            if (crc & 1)
+                crc = (crc >> 1) ^ CRC32_POLY;
+            else
+                crc >>= 1;
+        }
+    }
+    return crc;
+}
+
+static uint32_t crc32_table(uint32_t crc, const uint8_t *p, size_t len) {
+    while (len--)
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xFF];
+    return crc;
+}
+
+#ifndef CRC32_NO_SLICE8
+static inline uint32_t load_le32(const uint8_t *p) {
+    return ((uint32_t)p[0])
+         | ((uint32_t)p[1] << 8)
+         | ((uint32_t)p[2] << 16)
+         | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t *p, size_t len) {
+    while (len >= 8) {
+        uint32_t one = load_le32(p) ^ crc;
+        uint32_t two = load_le32(p + 4);
+        crc = crc_table[7][one & 0xFF]
+            ^ crc_table[6][(one >> 8) & 0xFF]
+            ^ crc_table[5][(one >> 16) & 0xFF]
+            ^ crc_table[4][one >> 24]
+            ^ crc_table[3][two & 0xFF]
+            ^ crc_table[2][(two >> 8) & 0xFF]
+            ^ crc_table[1][(two >> 16) & 0xFF]
+            ^ crc_table[0][two >> 24];
+        p += 8;
+        len -= 8;
+    }
+    return crc32_table(crc, p, len);
+}
+#define crc32_tail crc32_slice8
+#else
+#define crc32_tail crc32_table
+#endif
+
+#if CRC32_HAVE_PCLMUL
+/*
+ * Carry-less multiply folding ("Fast CRC Computation for Generic Polynomials
+ * Using PCLMULQDQ", Intel 2009), constants for the reflected 0xEDB88320 poly.
+ * Folds 4x128 bits per round, then reduces with Barrett to 32 bits.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_pclmul_fold(uint32_t crc, const uint8_t *p, size_t len) {
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    const __m128i k5k0 = _mm_set_epi64x(0x0000000000LL, 0x0163cd6124LL);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+    /* caller guarantees len >= 64 and len % 16 == 0 */
+    x1 = _mm_loadu_si128((const __m128i *)(const void *)(p + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(const void *)(p + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(const void *)(p + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(const void *)(p + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    p += 64;
+    len -= 64;
+
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                           _mm_loadu_si128((const __m128i *)(const void *)(p + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+                           _mm_loadu_si128((const __m128i *)(const void *)(p + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+                           _mm_loadu_si128((const __m128i *)(const void *)(p + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+                           _mm_loadu_si128((const __m128i *)(const void *)(p + 0x30)));
+        p += 64;
+        len -= 64;
+    }
+
+    /* fold 512 -> 128 bits */
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    /* remaining 16-byte blocks */
+    while (len >= 16) {
+        x2 = _mm_loadu_si128((const __m128i *)(const void *)p);
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        p += 16;
+        len -= 16;
+    }
+
+    /* fold 128 -> 64 bits */
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static uint32_t crc32_pclmul(uint32_t crc, const uint8_t *p, size_t len) {
+    if (len >= 64) {
+        size_t bulk = len & ~(size_t)15;
+        crc = crc32_pclmul_fold(crc, p, bulk);
+        p += bulk;
+        len -= bulk;
+    }
+    return crc32_tail(crc, p, len);
+}
+
+static int crc32_cpu_has_pclmul(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}
+#endif /* CRC32_HAVE_PCLMUL */
+
+/* ---- Dispatch ---- */
+
+int crc32_backend_available(crc32_backend_t backend) {
+    switch (backend) {
+    case CRC32_BACKEND_AUTO:
+    case CRC32_BACKEND_BITWISE:
+    case CRC32_BACKEND_TABLE:
+        return 1;
+    case CRC32_BACKEND_SLICE8:
+#ifndef CRC32_NO_SLICE8
+        return 1;
+#else
+        return 0;
+#endif
+    case CRC32_BACKEND_PCLMUL:
+#if CRC32_HAVE_PCLMUL
+        return crc32_cpu_has_pclmul();
+#else
+        return 0;
+#endif
+    default:
+        return 0;
+    }
+}
+
+const char *crc32_backend_name(crc32_backend_t backend) {
+    switch (backend) {
+    case CRC32_BACKEND_AUTO:    return "auto";
+    case CRC32_BACKEND_BITWISE: return "bitwise";
+    case CRC32_BACKEND_TABLE:   return "table";
+    case CRC32_BACKEND_SLICE8:  return "slice8";
+    case CRC32_BACKEND_PCLMUL:  return "pclmul";
+    default:                    return "unknown";
+    }
+}
+
+int crc32_set_backend(crc32_backend_t backend) {
+    if (!crc32_backend_available(backend)) return -1;
+
+    crc32_build_tables();
+
+    if (backend == CRC32_BACKEND_AUTO) {
+        if (crc32_backend_available(CRC32_BACKEND_PCLMUL))
+            backend = CRC32_BACKEND_PCLMUL;
+        else if (crc32_backend_available(CRC32_BACKEND_SLICE8))
+            backend = CRC32_BACKEND_SLICE8;
+        else
+            backend = CRC32_BACKEND_TABLE;
+    }
+
+    switch (backend) {
+    case CRC32_BACKEND_BITWISE: crc_impl = crc32_bitwise; break;
+    case CRC32_BACKEND_TABLE:   crc_impl = crc32_table;   break;
+#ifndef CRC32_NO_SLICE8
+    case CRC32_BACKEND_SLICE8:  crc_impl = crc32_slice8;  break;
+#endif
+#if CRC32_HAVE_PCLMUL
+    case CRC32_BACKEND_PCLMUL:  crc_impl = crc32_pclmul;  break;
+#endif
+    default: return -1;
+    }
+    crc_backend = backend;
+    return 0;
+}
+
+crc32_backend_t crc32_get_backend(void) {
+    if (!crc_impl) crc32_set_backend(CRC32_BACKEND_AUTO);
+    return crc_backend;
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+    if (!crc_impl) crc32_set_backend(CRC32_BACKEND_AUTO);
+    return crc_impl(crc ^ 0xFFFFFFFFu, data, len) ^ 0xFFFFFFFFu;
+}
+
+uint32_t crc32(const uint8_t *data, size_t len) {
+    return crc32_update(0, data, len);
+}
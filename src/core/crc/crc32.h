@@ -0,0 +1,41 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief CRC-32 (IEEE 802.3, reflected poly 0xEDB88320) with selectable backends.
+ *
+ * All backends produce bit-identical results to the original bitwise
+ * implementation, so on-disk CRCs written by older firmware stay valid.
+ * The default (CRC32_BACKEND_AUTO) picks the fastest backend available on
+ * the running CPU the first time a CRC is computed.
+ */
+typedef enum {
+    CRC32_BACKEND_AUTO = 0,   ///< Pick the best available backend at runtime
+    CRC32_BACKEND_BITWISE,    ///< Reference implementation, 8 iterations per byte
+    CRC32_BACKEND_TABLE,      ///< 256-entry table, one lookup per byte
+    CRC32_BACKEND_SLICE8,     ///< Slicing-by-8, eight lookups per 8 bytes
+    CRC32_BACKEND_PCLMUL,     ///< x86-64 carry-less multiply folding
+    CRC32_BACKEND_COUNT
+} crc32_backend_t;
+
+/* Define CRC32_NO_SLICE8 on small targets to drop the 8 KiB slicing tables. */
+
+/* One-shot CRC of a buffer, same result as crc32_update(0, data, len). */
+uint32_t crc32(const uint8_t *data, size_t len);
+
+/*
+ * Incremental CRC: start with crc = 0 and feed the previous result back in.
+ * crc32_update(crc32_update(0, a, n), b, m) == crc32(a || b).
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len);
+
+/* Backend selection. Returns 0 on success, -1 if the backend is unavailable. */
+int crc32_set_backend(crc32_backend_t backend);
+crc32_backend_t crc32_get_backend(void);
+int crc32_backend_available(crc32_backend_t backend);
+const char *crc32_backend_name(crc32_backend_t backend);
+
+#endif /* CRC32_H */
@@ -1,28 +1,59 @@
 #include "helper.h"
 
-uint32_t crc32(const uint8_t *data, size_t len) {
-    uint32_t crc = 0xFFFFFFFF;
-    for (size_t i = 0; i < len; i++) {
-        crc ^= data[i];
-        for (int j = 0; j < 8; j++) {
-            if (crc & 1)
-                crc = (crc >> 1) ^ 0xEDB88320;
-            else
-                crc >>= 1;
-        }
-    }
-    return crc ^ 0xFFFFFFFF;
+uint8_t read_sector(uint64_t sector, uint8_t *buffer) {
+  if (!active_driver || !buffer)
+    return DRIVER_ERR_INIT;
+  return active_driver->read_block(active_driver, sector, buffer);
 }
 
+uint8_t write_sector(uint64_t sector, const uint8_t *buffer) {
+  if (!active_driver || !buffer)
+    return DRIVER_ERR_INIT;
+  return active_driver->write_block(active_driver, sector, buffer);
+}
 
-uint8_t read_sector(uint32_t sector, uint8_t *buffer) {
+uint8_t read_sectors(uint64_t sector, uint32_t count, uint8_t *buffer) {
   if (!active_driver || !buffer)
     return DRIVER_ERR_INIT;
-  return active_driver->read_block(active_driver, sector, buffer);
+  if (active_driver->read_blocks)
+    return active_driver->read_blocks(active_driver, sector, count, buffer);
+
+  for (uint32_t i = 0; i < count; i++) {
+    int rc = active_driver->read_block(active_driver, sector + i,
+                                       buffer + (size_t)i * active_driver->sector_size);
+    if (rc != DRIVER_OK)
+      return rc;
+  }
+  return DRIVER_OK;
 }
 
-uint8_t write_sector(uint32_t sector, const uint8_t *buffer) {
+uint8_t write_sectors(uint64_t sector, uint32_t count, const uint8_t *buffer) {
   if (!active_driver || !buffer)
     return DRIVER_ERR_INIT;
-  return active_driver->write_block(active_driver, sector, buffer);
+  if (active_driver->write_blocks)
+    return active_driver->write_blocks(active_driver, sector, count, buffer);
+
+  for (uint32_t i = 0; i < count; i++) {
+    int rc = active_driver->write_block(active_driver, sector + i,
+                                        buffer + (size_t)i * active_driver->sector_size);
+    if (rc != DRIVER_OK)
+      return rc;
+  }
+  return DRIVER_OK;
+}
+
+uint8_t write_batch(const driver_write_t *reqs, uint32_t nreqs, uint32_t flags) {
+  if (!active_driver || !reqs)
+    return DRIVER_ERR_INIT;
+  if (active_driver->write_batch)
+    return active_driver->write_batch(active_driver, reqs, nreqs, flags);
+
+  for (uint32_t i = 0; i < nreqs; i++) {
+    uint8_t rc = write_sectors(reqs[i].lba, reqs[i].count, reqs[i].buffer);
+    if (rc != DRIVER_OK)
+      return rc;
+  }
+  if ((flags & DRIVER_BATCH_SYNC) && active_driver->sync)
+    return active_driver->sync(active_driver);
+  return DRIVER_OK;
 }
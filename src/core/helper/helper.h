@@ -7,11 +7,16 @@
 
 //#include "storage.h"
 #include "driver.h"
+#include "crc32.h"
 
 extern driver_t *active_driver;
 
-uint32_t crc32(const uint8_t *data, size_t len);
-uint8_t read_sector(uint32_t sector, uint8_t *buffer);
-uint8_t write_sector(uint32_t sector, const uint8_t *buffer);
+uint8_t read_sector(uint64_t sector, uint8_t *buffer);
+uint8_t write_sector(uint64_t sector, const uint8_t *buffer);
+
+/* Multi-sector spans; fall back to per-block loops if the driver lacks them */
+uint8_t read_sectors(uint64_t sector, uint32_t count, uint8_t *buffer);
+uint8_t write_sectors(uint64_t sector, uint32_t count, const uint8_t *buffer);
+uint8_t write_batch(const driver_write_t *reqs, uint32_t nreqs, uint32_t flags);
 
 #endif /* HELPER_H */
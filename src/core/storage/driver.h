@@ -4,22 +4,40 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/**
+ * @brief One contiguous write inside a batch (e.g. one mirror copy of a span).
+ */
+typedef struct {
+    uint64_t lba;
+    uint32_t count;          ///< Number of sectors
+    const uint8_t *buffer;
+} driver_write_t;
+
+/* write_batch flags */
+#define DRIVER_BATCH_SYNC  0x01  ///< Make the whole batch durable before returning
+
 /**
  * @brief Generic block device interface for the filesystem.
  *
  * Every backend (e.g. SD card, USB flash drive, RAM disk, or file mock)
  * must implement this structure and its function pointers.
+ * The multi-sector ops are optional: leave them NULL and the helpers fall
+ * back to looping over read_block/write_block. write_batch lets a driver
+ * keep several independent writes in flight at once (mirror copies).
  */
 typedef struct driver {
     const char *name;        ///< Human-readable identifier (e.g. "sd", "linux", "mock")
-    uint32_t sector_size;    ///< Usually 512 bytes; can differ for advanced devices
+    uint32_t sector_size;    ///< Logical block size (SECTOR_SIZE); drivers split it into device sectors
     void *ctx;               ///< Optional context pointer (e.g. FILE* or SPI handle)
     uint64_t total_size_bytes;
-    uint64_t total_sectors;
+    uint64_t total_sectors;  ///< In sector_size blocks
 
     int  (*init)(struct driver *self);
-    int  (*read_block)(struct driver *self, uint32_t lba, uint8_t *buffer);
-    int  (*write_block)(struct driver *self, uint32_t lba, const uint8_t *buffer);
+    int  (*read_block)(struct driver *self, uint64_t lba, uint8_t *buffer);
+    int  (*write_block)(struct driver *self, uint64_t lba, const uint8_t *buffer);
+    int  (*read_blocks)(struct driver *self, uint64_t lba, uint32_t count, uint8_t *buffer);
+    int  (*write_blocks)(struct driver *self, uint64_t lba, uint32_t count, const uint8_t *buffer);
+    int  (*write_batch)(struct driver *self, const driver_write_t *reqs, uint32_t nreqs, uint32_t flags);
     int  (*sync)(struct driver *self);
     void (*deinit)(struct driver *self);
 } driver_t;
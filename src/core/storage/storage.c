@@ -2,296 +2,1355 @@
 #include "config.h"
 #include "driver.h"
 #include "helper.h"
+#include "codec.h"
+#include "columns.h"
+#include "erasure.h"
 
-#include <math.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
-
-/* ---- Return codes ---- */
-#define STORAGE_OK 0
-#define STORAGE_ERR_DRIVER 1
-#define STORAGE_ERR_PARAM 2
-#define STORAGE_ERR_FULL 3
-#define STORAGE_ERR_LOG_FULL 4
-#define STORAGE_ERR_META 5
+#include <string.h>
 
 /* Global driver pointer (assigned externally, e.g. from main.c) */
 extern uint32_t log_sector;
 
+/* ---- Cached superblock: loaded once, written through, never read back ----
+ * [0..2] last logical sector, [3..4] message count, [5] message log full,
+ * [6..8] scrub cursor, [9] log2 of the block size (0 on older 512-byte
+ * cards), [10] layout version, [11] data sectors per parity group (0 =
+ * mirrored), [12] parity sectors per group, [16..23] last logical sector and
+ * [24..31] scrub cursor in 64 bits, [SECTOR_SIZE-4 ..] CRC.
+ * Version 0 cards carry only the 24-bit fields and are lifted to the
+ * current version in RAM on load. The 24-bit copies are still written,
+ * saturated at 0xFFFFFF, so older readers see the first 16M sectors. */
+#define SB_BLOCK_SHIFT (SECTOR_SIZE == 4096 ? 12 : SECTOR_SIZE == 2048 ? 11 : \
+                        SECTOR_SIZE == 1024 ? 10 : 9)
+#define SB_VERSION 2
+#define SB_LEGACY_MAX 0xFFFFFFu
+static uint8_t sb_sector[SECTOR_SIZE];
+static uint8_t sb_loaded = 0;
+
+/* ---- Message log: RAM copy of sector log_sector + 1 ----
+ * [0 .. MSG_CAPACITY-1] one byte per message, [SECTOR_SIZE-4 ..] CRC.
+ * The message count lives in superblock bytes 3..4, byte 5 flags "full". */
+#define MSG_CAPACITY (SECTOR_SIZE - CRC_SIZE)
+static uint8_t msg_sector[SECTOR_SIZE];
+static uint16_t msg_count = 0;
+static uint16_t msg_unflushed = 0;
+static uint32_t msg_window_start_ms = 0;
+static storage_msg_policy_t msg_policy = { 0, 0, NULL };
+
+/* ---- Group commit state ---- */
+static storage_commit_policy_t commit_policy = { 1, 0, NULL };
+static uint32_t pending_records = 0;   // appends not yet covered by the superblock
+static uint64_t pending_last = 0;      // tail to publish on the next commit
+static uint32_t window_start_ms = 0;
+
+/* ---- Open reservation: sectors laid out in place, sealed on commit ---- */
+static uint8_t resv_buf[STORAGE_RESERVE_SECTORS][SECTOR_SIZE];
+static uint32_t resv_count = 0;
+
+/* ---- Packed record stream: RAM copy of the sector being filled ---- */
+#define PACK_AREA (PAYLOAD_SIZE - 2)
+static uint8_t pack_sector[SECTOR_SIZE];
+static uint16_t pack_fill = 0;                    // stream bytes used
+static uint16_t pack_first = STORAGE_PACK_NONE;   // first record start in this sector
+static uint8_t pack_emit(void);
+
+/* ---- Write path compression ---- */
+static uint8_t compress_mode = STORAGE_COMPRESS_OFF;
+
+/* ---- Redundancy layout ----
+ * The device is cut into slices of RAID_OFFSET sectors, each starting
+ * with a superblock and message log copy: RAID_MIRRORS mirrors, or one
+ * slice per column of a parity group. There logical sector L >= 2 is
+ * column (L - 2) % ec_k of row 2 + (L - 2) / ec_k and parity j of a row
+ * sits in slice ec_k + j, so a row of data costs ec_k + ec_m sectors. */
+#define SLICES_MAX 8   // RAID_MIRRORS and EC_DATA_MAX + EC_PARITY_MAX both fit
+static uint8_t slices = RAID_MIRRORS;
+static uint8_t ec_k = 0, ec_m = 0;       // loaded card, ec_k 0 = mirrored
+static uint8_t fmt_k = 0, fmt_m = 0;     // for the next init_log_sector()
+static uint8_t ec_parity[EC_PARITY_MAX][SECTOR_SIZE];   // parity of row ec_row
+static uint64_t ec_row = 0;              // row being appended to, 0 = none cached
+static uint8_t ec_dirty = 0;             // ec_parity not on the card yet
+
+/* ---- Read path state ---- */
+static uint8_t read_mode = STORAGE_READ_FAST;
+static uint32_t mirror_errors[SLICES_MAX];   // steers which mirror is read first
+
+/* ---- Scrubber state, the cursor itself lives in sb_sector ---- */
+static storage_scrub_stats_t scrub_stats;
+static uint32_t scrub_unpersisted = 0;   // sectors scrubbed since the cursor was written
+
 /*### INTERNAL STATE FUNCTIONS ###*/
+/* Write one metadata sector to every mirror, then flush */
+static int write_meta_mirrors(uint64_t sector, const uint8_t *buffer) {
+    driver_write_t reqs[SLICES_MAX];
+    for (uint8_t i = 0; i < slices; i++) {
+        reqs[i].lba = sector + (i * RAID_OFFSET);
+        reqs[i].count = 1;
+        reqs[i].buffer = buffer;
+    }
+    return write_batch(reqs, slices, DRIVER_BATCH_SYNC);
+}
+
+/* Finish a data sector whose payload is already in place: header, pad, CRC */
+static void seal_sector(uint8_t *sector_buffer, uint8_t header) {
+  const uint16_t off = SECTOR_SIZE - 4;
+
+  // header
+  sector_buffer[0] = header;
+
+  // clear padding between payload and CRC
+  memset(&sector_buffer[HEADER_SIZE + PAYLOAD_SIZE], 0,
+         off - (HEADER_SIZE + PAYLOAD_SIZE));
+
+  // CRC (end of sector)
+  uint32_t crc = crc32(sector_buffer, HEADER_SIZE + PAYLOAD_SIZE);
+  sector_buffer[off + 0] = (uint8_t)(crc & 0xFF);
+  sector_buffer[off + 1] = (uint8_t)((crc >> 8) & 0xFF);
+  sector_buffer[off + 2] = (uint8_t)((crc >> 16) & 0xFF);
+  sector_buffer[off + 3] = (uint8_t)((crc >> 24) & 0xFF);
+}
+
+/* Lay out n payload chunks as [header][payload][pad][crc] sectors */
+static void format_sectors(const uint8_t *payload, uint32_t n, uint8_t header,
+                           uint8_t *out) {
+  for (uint32_t s = 0; s < n; s++) {
+    uint8_t *sector_buffer = out + (size_t)s * SECTOR_SIZE;
+    memcpy(&sector_buffer[1], &payload[(size_t)s * PAYLOAD_SIZE], PAYLOAD_SIZE);
+    seal_sector(sector_buffer, header);
+  }
+}
+
 /* === INTERNAL STATE FUNCTIONS WITH CRC === */
-uint8_t get_last_sector(uint32_t *last_sector) {
-    if (!last_sector) return STORAGE_ERR_PARAM;
+/* Seal a metadata sector: CRC over everything but the last 4 bytes */
+static void seal_meta(uint8_t *buffer) {
+    uint32_t crc = crc32(buffer, SECTOR_SIZE - 4);
+    buffer[SECTOR_SIZE-4] = (uint8_t)(crc & 0xFF);
+    buffer[SECTOR_SIZE-3] = (uint8_t)((crc >> 8) & 0xFF);
+    buffer[SECTOR_SIZE-2] = (uint8_t)((crc >> 16) & 0xFF);
+    buffer[SECTOR_SIZE-1] = (uint8_t)((crc >> 24) & 0xFF);
+}
 
-    uint8_t  buffer[3][SECTOR_SIZE];
-    uint32_t value[3];
-    uint8_t  valid[3] = {0};
+static uint8_t meta_crc_ok(const uint8_t *buffer) {
+    uint32_t stored_crc =
+          ((uint32_t)buffer[SECTOR_SIZE-4])
+        | ((uint32_t)buffer[SECTOR_SIZE-3] << 8)
+        | ((uint32_t)buffer[SECTOR_SIZE-2] << 16)
+        | ((uint32_t)buffer[SECTOR_SIZE-1] << 24);
+    return stored_crc == crc32(buffer, SECTOR_SIZE - 4);
+}
 
+static uint8_t data_crc_ok(const uint8_t *sector) {
+    const uint16_t off = SECTOR_SIZE - 4;
+    uint32_t stored_crc =
+          ((uint32_t)sector[off])
+        | ((uint32_t)sector[off + 1] << 8)
+        | ((uint32_t)sector[off + 2] << 16)
+        | ((uint32_t)sector[off + 3] << 24);
+    return stored_crc == crc32(sector, HEADER_SIZE + PAYLOAD_SIZE);
+}
+
+/* Mirror indices, fewest errors first (ties keep mirror order) */
+static void mirror_order(uint8_t *order) {
     for (uint8_t i = 0; i < RAID_MIRRORS; i++) {
-        uint32_t meta_sector = log_sector + (i * RAID_OFFSET);
-        int rc = read_sector(meta_sector, buffer[i]);
-        if (rc != DRIVER_OK) continue;
-
-        uint32_t stored_crc =
-              ((uint32_t)buffer[i][SECTOR_SIZE-4])
-            | ((uint32_t)buffer[i][SECTOR_SIZE-3] << 8)
-            | ((uint32_t)buffer[i][SECTOR_SIZE-2] << 16)
-            | ((uint32_t)buffer[i][SECTOR_SIZE-1] << 24);
-
-        uint32_t calc_crc = crc32(buffer[i], SECTOR_SIZE - 4);
-        if (stored_crc == calc_crc) {
-            value[i] = ((uint32_t)buffer[i][0])
-                     | ((uint32_t)buffer[i][1] << 8)
-                     | ((uint32_t)buffer[i][2] << 16);
+        uint8_t j = i;
+        while (j > 0 && mirror_errors[order[j - 1]] > mirror_errors[i]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+}
+
+/* Read every mirror of one logical sector; index of the copy most valid
+ * mirrors agree on, or -1 if none is valid */
+static int8_t vote_sector(uint64_t logical, uint8_t copies[][SECTOR_SIZE], uint8_t *valid) {
+    for (uint8_t m = 0; m < RAID_MIRRORS; m++) {
+        valid[m] = read_sector(logical + (m * RAID_OFFSET), copies[m]) == DRIVER_OK &&
+                   data_crc_ok(copies[m]);
+        if (!valid[m]) mirror_errors[m]++;
+    }
+
+    int8_t best = -1;
+    uint8_t best_votes = 0;
+    for (uint8_t m = 0; m < RAID_MIRRORS; m++) {
+        if (!valid[m]) continue;
+        uint8_t votes = 0;
+        for (uint8_t k = 0; k < RAID_MIRRORS; k++)
+            votes += valid[k] && memcmp(copies[m], copies[k], SECTOR_SIZE) == 0;
+        if (votes > best_votes) {
+            best = (int8_t)m;
+            best_votes = votes;
+        }
+    }
+    if (best < 0) return -1;
+
+    // a valid but outvoted copy is stale, count it against its mirror
+    for (uint8_t m = 0; m < RAID_MIRRORS; m++)
+        if (valid[m] && memcmp(copies[m], copies[best], SECTOR_SIZE) != 0)
+            mirror_errors[m]++;
+    return best;
+}
+
+static uint8_t read_voted(uint64_t logical, uint8_t *out) {
+    uint8_t copies[RAID_MIRRORS][SECTOR_SIZE];
+    uint8_t valid[RAID_MIRRORS];
+
+    int8_t best = vote_sector(logical, copies, valid);
+    if (best < 0) return STORAGE_ERR_CORRUPT;
+    memcpy(out, copies[best], SECTOR_SIZE);
+    return STORAGE_OK;
+}
+
+/* ---- Parity groups ---- */
+static uint64_t ec_row_of(uint64_t logical) {
+    return 2 + (logical - 2) / ec_k;
+}
+
+static uint8_t ec_col_of(uint64_t logical) {
+    return (uint8_t)((logical - 2) % ec_k);
+}
+
+/* Physical sector of a row's data column, or parity j as column ec_k + j */
+static uint64_t ec_lba(uint64_t row, uint8_t col) {
+    return row + (col * RAID_OFFSET);
+}
+
+/* Write the open row's parity if appends since the last write changed it */
+static uint8_t ec_flush(void) {
+    driver_write_t reqs[EC_PARITY_MAX];
+
+    if (!ec_dirty)
+        return STORAGE_OK;
+    for (uint8_t j = 0; j < ec_m; j++) {
+        reqs[j].lba = ec_lba(ec_row, ec_k + j);
+        reqs[j].count = 1;
+        reqs[j].buffer = ec_parity[j];
+    }
+    if (write_batch(reqs, ec_m, 0) != DRIVER_OK)
+        return STORAGE_ERR_DRIVER;
+    ec_dirty = 0;
+    return STORAGE_OK;
+}
+
+/* Rebuild data column want of row from the other columns and the parity.
+ * Columns past last are not written yet and count as zero. */
+static uint8_t ec_rebuild(uint64_t row, uint64_t last, uint8_t want, uint8_t *out) {
+    uint8_t syn[EC_PARITY_MAX][SECTOR_SIZE];
+    uint8_t buf[SECTOR_SIZE];
+    uint8_t rows[EC_PARITY_MAX], lost[EC_PARITY_MAX];
+    uint8_t nrows = 0, nlost = 0;
+    uint64_t first = 2 + (row - 2) * ec_k;
+    uint8_t width = (last - first + 1 < ec_k) ? (uint8_t)(last - first + 1) : ec_k;
+
+    if (row == ec_row && ec_flush() != STORAGE_OK)
+        return STORAGE_ERR_DRIVER;
+    for (uint8_t j = 0; j < ec_m; j++) {
+        if (read_sector(ec_lba(row, ec_k + j), syn[nrows]) == DRIVER_OK) rows[nrows++] = j;
+        else mirror_errors[ec_k + j]++;
+    }
+
+    lost[nlost++] = want;
+    for (uint8_t c = 0; c < width; c++) {
+        if (c == want) continue;
+        if (read_sector(ec_lba(row, c), buf) == DRIVER_OK && data_crc_ok(buf)) {
+            for (uint8_t r = 0; r < nrows; r++)
+                ec_mul_add(syn[r], buf, SECTOR_SIZE, ec_coef(rows[r], c));
+            continue;
+        }
+        mirror_errors[c]++;
+        if (nlost >= nrows) return STORAGE_ERR_CORRUPT;
+        lost[nlost++] = c;
+    }
+    if (nlost > nrows) return STORAGE_ERR_CORRUPT;
+
+    // one column lost and two parities left: if P was stale, Q may still do
+    for (uint8_t r = 0; r + nlost <= nrows; r++) {
+        const uint8_t *use[EC_PARITY_MAX] = { syn[r], syn[nrows - 1] };
+        ec_solve(out, use, rows + r, lost, nlost, 0, SECTOR_SIZE);
+        if (data_crc_ok(out)) return STORAGE_OK;
+    }
+    return STORAGE_ERR_CORRUPT;
+}
+
+/* One logical sector: its own column, or rebuilt from the rest of the row */
+static uint8_t ec_read(uint64_t logical, uint64_t last, uint8_t *out) {
+    uint64_t row = ec_row_of(logical);
+    uint8_t col = ec_col_of(logical);
+
+    if (read_sector(ec_lba(row, col), out) == DRIVER_OK && data_crc_ok(out))
+        return STORAGE_OK;
+    mirror_errors[col]++;
+    return ec_rebuild(row, last, col, out);
+}
+
+/* Parity of row over its first ncols columns, read back from the card */
+static uint8_t ec_prime(uint64_t row, uint8_t ncols) {
+    uint8_t buf[SECTOR_SIZE];
+    uint64_t first = 2 + (row - 2) * ec_k;
+
+    memset(ec_parity, 0, sizeof(ec_parity));
+    ec_row = 0;
+    for (uint8_t c = 0; c < ncols; c++) {
+        uint8_t rc = ec_read(first + c, first + ncols - 1, buf);
+        if (rc != STORAGE_OK)
+            return rc;
+        for (uint8_t j = 0; j < ec_m; j++)
+            ec_mul_add(ec_parity[j], buf, SECTOR_SIZE, ec_coef(j, c));
+    }
+    ec_row = row;
+    return STORAGE_OK;
+}
+
+/* Append n sectors at logical lba. Rows only grow, so the open row's
+ * parity stays in RAM and each new column is folded in once. The parity
+ * goes out with the column that completes the row, otherwise once per
+ * commit (ec_flush() from commit_pending()), so a commit window of single
+ * sector appends costs (ec_k + ec_m) / ec_k writes per sector. */
+static uint8_t ec_write_span(uint64_t lba, uint32_t n, const uint8_t *span) {
+    driver_write_t reqs[EC_DATA_MAX + EC_PARITY_MAX];
+
+    for (uint32_t s = 0; s < n;) {
+        uint64_t row = ec_row_of(lba + s);
+        uint8_t col = ec_col_of(lba + s);
+        uint8_t rc;
+        if (row != ec_row && ((rc = ec_flush()) != STORAGE_OK || (rc = ec_prime(row, col)) != STORAGE_OK))
+            return rc;
+
+        uint8_t nreq = 0;
+        for (; s < n && col < ec_k; s++, col++) {
+            const uint8_t *sec = span + (size_t)s * SECTOR_SIZE;
+            for (uint8_t j = 0; j < ec_m; j++)
+                ec_mul_add(ec_parity[j], sec, SECTOR_SIZE, ec_coef(j, col));
+            reqs[nreq].lba = ec_lba(row, col);
+            reqs[nreq].count = 1;
+            reqs[nreq++].buffer = sec;
+        }
+        ec_dirty = 1;
+        for (uint8_t j = 0; j < ec_m && col == ec_k; j++) {
+            reqs[nreq].lba = ec_lba(row, ec_k + j);
+            reqs[nreq].count = 1;
+            reqs[nreq++].buffer = ec_parity[j];
+        }
+        if (write_batch(reqs, nreq, 0) != DRIVER_OK) {
+            ec_row = 0;   // the card may hold part of it, prime again
+            ec_dirty = 0;
+            return STORAGE_ERR_DRIVER;
+        }
+        if (col == ec_k)
+            ec_dirty = 0;
+    }
+    return STORAGE_OK;
+}
+
+static uint64_t sb_get(const uint8_t *sb, uint16_t off, uint8_t n) {
+    uint64_t v = 0;
+    for (uint8_t i = 0; i < n; i++)
+        v |= (uint64_t)sb[off + i] << (8 * i);
+    return v;
+}
+
+static void sb_put(uint8_t *sb, uint16_t off, uint8_t n, uint64_t v) {
+    for (uint8_t i = 0; i < n; i++)
+        sb[off + i] = (uint8_t)(v >> (8 * i));
+}
+
+/* Tail of a superblock of any version */
+static uint64_t sb_tail(const uint8_t *sb) {
+    return sb[10] >= SB_VERSION ? sb_get(sb, 16, 8) : sb_get(sb, 0, 3);
+}
+
+/* 64-bit field plus its saturated 24-bit copy */
+static void sb_put_wide(uint8_t *sb, uint16_t off, uint16_t legacy_off, uint64_t v) {
+    sb_put(sb, off, 8, v);
+    sb_put(sb, legacy_off, 3, v > SB_LEGACY_MAX ? SB_LEGACY_MAX : v);
+}
+
+static void compute_raid_offset(void) {
+    RAID_OFFSET = active_driver->total_sectors / slices;
+}
+
+/* Stage the message sector from the first mirror with a valid CRC */
+static uint8_t load_msg_log(void) {
+    msg_count = ((uint16_t)sb_sector[3]) | ((uint16_t)sb_sector[4] << 8);
+    msg_unflushed = 0;
+    if (msg_count > MSG_CAPACITY) msg_count = MSG_CAPACITY;
+
+    for (uint8_t i = 0; i < slices; i++) {
+        if (read_sector(log_sector + 1 + (i * RAID_OFFSET), msg_sector) == DRIVER_OK &&
+            meta_crc_ok(msg_sector))
+            return STORAGE_OK;
+    }
+
+    memset(msg_sector, 0, SECTOR_SIZE);
+    if (msg_count)
+        printf("[META] message log unreadable, %u messages lost\n", msg_count);
+    return STORAGE_OK;
+}
+
+/* Slices a superblock describes */
+static uint8_t sb_slices(const uint8_t *sb) {
+    return sb[11] ? (uint8_t)(sb[11] + sb[12]) : RAID_MIRRORS;
+}
+
+/* Copy of the superblock most valid copies agree on (ties: lowest slice)
+ * in a layout of n slices, or -1. A copy only counts in the layout it
+ * describes itself, and with a tail past the message sector: an empty
+ * message sector is a zeroed, sealed v0 superblock otherwise. */
+static int8_t vote_superblock(uint8_t n, uint8_t *buffer, uint8_t report) {
+    uint64_t value[SLICES_MAX];
+    uint8_t  valid[SLICES_MAX] = {0};
+    uint64_t offset = active_driver->total_sectors / n;
+
+    for (uint8_t i = 0; i < n && offset; i++) {
+        if (read_sector(log_sector + (i * offset), buffer) != DRIVER_OK) continue;
+
+        if (meta_crc_ok(buffer) && sb_slices(buffer) == n && sb_tail(buffer) > log_sector) {
+            value[i] = sb_tail(buffer);
             valid[i] = 1;
-        } else {
+        } else if (report) {
             printf("[META] mirror %u CRC mismatch\n", i);
         }
     }
 
-    // choose majority or any valid copy
-    uint8_t valid_count = valid[0] + valid[1] + valid[2];
-    if (valid_count == 0) return STORAGE_ERR_META;
+    int8_t chosen = -1;
+    uint8_t best_votes = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        if (!valid[i]) continue;
+        uint8_t votes = 0;
+        for (uint8_t j = 0; j < n; j++)
+            votes += valid[j] && value[j] == value[i];
+        if (votes > best_votes) {
+            chosen = (int8_t)i;
+            best_votes = votes;
+        }
+    }
+    if (chosen < 0 || read_sector(log_sector + (chosen * offset), buffer) != DRIVER_OK)
+        return -1;
+    return chosen;
+}
+
+/* Read every superblock copy once, majority-vote and cache the winner.
+ * The slice count is only known from a valid copy: the layout copy 0
+ * names is tried first, then (copy 0 lost) every other one. */
+static uint8_t load_superblock(void) {
+    uint8_t buffer[SECTOR_SIZE];
+    uint8_t first = RAID_MIRRORS, n = RAID_MIRRORS;
+    int8_t chosen = -1;
 
-    uint32_t candidate = 0;
-    if (valid[0] && valid[1] && value[0] == value[1]) candidate = value[0];
-    else if (valid[1] && valid[2] && value[1] == value[2]) candidate = value[1];
-    else if (valid[0] && valid[2] && value[0] == value[2]) candidate = value[0];
-    else if (valid[0]) candidate = value[0];
-    else if (valid[1]) candidate = value[1];
-    else candidate = value[2];
+    sb_loaded = 0;
+    if (read_sector(log_sector, buffer) == DRIVER_OK && meta_crc_ok(buffer))
+        first = sb_slices(buffer);
+    for (uint8_t t = 0; t <= SLICES_MAX && chosen < 0; t++) {
+        n = t ? t : first;
+        if ((t && n == first) || n > SLICES_MAX) continue;
+        chosen = vote_superblock(n, buffer, t == 0);
+    }
+    if (chosen < 0) return STORAGE_ERR_META;
 
-    *last_sector = candidate;
+    // a card formatted with other blocks rarely gets this far (its CRC sits elsewhere)
+    uint8_t shift = buffer[9];
+    if (shift != SB_BLOCK_SHIFT && !(shift == 0 && SECTOR_SIZE == 512)) {
+        printf("[META] card block shift %u, built for %u-byte blocks\n", shift, SECTOR_SIZE);
+        return STORAGE_ERR_META;
+    }
+    if (buffer[10] > SB_VERSION) {
+        printf("[META] superblock version %u, newer than this build\n", buffer[10]);
+        return STORAGE_ERR_META;
+    }
+    if (buffer[11] && (buffer[11] < 2 || buffer[11] > EC_DATA_MAX ||
+                       buffer[12] < 1 || buffer[12] > EC_PARITY_MAX)) {
+        printf("[META] unsupported parity group %u+%u\n", buffer[11], buffer[12]);
+        return STORAGE_ERR_META;
+    }
+
+    slices = n;
+    ec_k = buffer[11];
+    ec_m = buffer[12];
+    ec_row = 0;
+    ec_dirty = 0;
+    if (ec_k)
+        ec_init();
+    compute_raid_offset();
+    memcpy(sb_sector, buffer, SECTOR_SIZE);
+    if (sb_sector[10] < SB_VERSION) {
+        // 24-bit card: widen in RAM, the next superblock write upgrades it
+        sb_put(sb_sector, 16, 8, sb_get(sb_sector, 0, 3));
+        sb_put(sb_sector, 24, 8, sb_get(sb_sector, 6, 3));
+        sb_sector[10] = SB_VERSION;
+    }
+    sb_loaded = 1;
+    return load_msg_log();
+}
+
+uint8_t get_last_sector(uint64_t *last_sector) {
+    if (!last_sector) return STORAGE_ERR_PARAM;
+    if (!sb_loaded) return STORAGE_ERR_META;
+
+    *last_sector = sb_get(sb_sector, 16, 8);
     return STORAGE_OK;
 }
 
 
-uint8_t set_last_sector(const uint32_t *last_sector) {
+uint8_t set_last_sector(const uint64_t *last_sector) {
     if (!last_sector) return STORAGE_ERR_PARAM;
+    if (!sb_loaded) return STORAGE_ERR_META;
 
-    uint8_t buffer[SECTOR_SIZE];
-    int rc = read_sector(log_sector, buffer);
+    // update cached value, no read-back
+    sb_put_wide(sb_sector, 16, 0, *last_sector);
+    seal_meta(sb_sector);
+
+    // write all mirrors as one durable batch
+    int rc = write_meta_mirrors(log_sector, sb_sector);
     if (rc != DRIVER_OK) return STORAGE_ERR_DRIVER;
+    return STORAGE_OK;
+}
 
-    // update value
-    buffer[0] = (uint8_t)(*last_sector & 0xFF);
-    buffer[1] = (uint8_t)((*last_sector >> 8) & 0xFF);
-    buffer[2] = (uint8_t)((*last_sector >> 16) & 0xFF);
 
-    // recompute CRC
-    uint32_t crc = crc32(buffer, SECTOR_SIZE - 4);
-    buffer[SECTOR_SIZE-4] = (uint8_t)(crc & 0xFF);
-    buffer[SECTOR_SIZE-3] = (uint8_t)((crc >> 8) & 0xFF);
-    buffer[SECTOR_SIZE-2] = (uint8_t)((crc >> 16) & 0xFF);
-    buffer[SECTOR_SIZE-1] = (uint8_t)((crc >> 24) & 0xFF);
+/* Superblock copies of any other layout would be found again once copy 0
+ * is lost; overwrite them while the log is still empty */
+static int clear_stale_superblocks(void) {
+    uint8_t zero[SECTOR_SIZE];
+    memset(zero, 0, SECTOR_SIZE);
 
-    // write all mirrors
-    for (uint8_t i = 0; i < RAID_MIRRORS; i++) {
-        uint32_t meta_sector = log_sector + (i * RAID_OFFSET);
-        rc = write_sector(meta_sector, buffer);
-        if (rc != DRIVER_OK) return STORAGE_ERR_DRIVER;
+    for (uint8_t n = 2; n <= SLICES_MAX; n++) {
+        if (n == slices) continue;
+        uint64_t offset = active_driver->total_sectors / n;
+        for (uint8_t i = 1; i < n; i++) {
+            uint64_t lba = log_sector + (i * offset);
+            if (lba % RAID_OFFSET == log_sector && lba / RAID_OFFSET < slices) continue;
+            int rc = write_sector(lba, zero);
+            if (rc != DRIVER_OK) return rc;
+        }
     }
+    return DRIVER_OK;
+}
 
-    if (active_driver->sync) active_driver->sync(active_driver);
+uint8_t storage_set_redundancy(uint8_t data, uint8_t parity) {
+    if (data == 0 && parity == 0) {
+        fmt_k = fmt_m = 0;
+        return STORAGE_OK;
+    }
+    if (data < 2 || data > EC_DATA_MAX || parity < 1 || parity > EC_PARITY_MAX)
+        return STORAGE_ERR_PARAM;
+    fmt_k = data;
+    fmt_m = parity;
+    ec_init();
     return STORAGE_OK;
 }
 
-
 uint8_t init_log_sector(void) {
-    RAID_OFFSET = (uint32_t)floor(active_driver->total_sectors / RAID_MIRRORS);
+    slices = fmt_k ? fmt_k + fmt_m : RAID_MIRRORS;
+    ec_k = fmt_k;
+    ec_m = fmt_m;
+    ec_row = 0;
+    ec_dirty = 0;
+    compute_raid_offset();
     if (RAID_OFFSET == 0) return STORAGE_ERR_PARAM;
-    printf("RAID_OFFSET: %u\n", RAID_OFFSET);
+    printf("RAID_OFFSET: %llu\n", (unsigned long long)RAID_OFFSET);
+    if (clear_stale_superblocks() != DRIVER_OK) return STORAGE_ERR_DRIVER;
 
     // prepare zeroed metadata
-    uint8_t buffer[SECTOR_SIZE];
+    uint8_t *buffer = sb_sector;
     for (uint16_t i = 0; i < SECTOR_SIZE; i++) buffer[i] = 0;
 
-    const uint32_t start_sector = 1;
+    const uint64_t start_sector = 1;
     const uint16_t last_msg = 0;
-    buffer[0] = (uint8_t)(start_sector & 0xFF);
-    buffer[1] = (uint8_t)((start_sector >> 8) & 0xFF);
-    buffer[2] = (uint8_t)((start_sector >> 16) & 0xFF);
+    sb_put_wide(buffer, 16, 0, start_sector);
     buffer[3] = (uint8_t)(last_msg & 0xFF);
     buffer[4] = (uint8_t)((last_msg >> 8) & 0xFF);
     buffer[5] = 0; // not full
+    buffer[9] = SB_BLOCK_SHIFT;
+    buffer[10] = SB_VERSION;
+    buffer[11] = ec_k;
+    buffer[12] = ec_m;
 
     // compute CRC
-    uint32_t crc = crc32(buffer, SECTOR_SIZE - 4);
-    buffer[SECTOR_SIZE-4] = (uint8_t)(crc & 0xFF);
-    buffer[SECTOR_SIZE-3] = (uint8_t)((crc >> 8) & 0xFF);
-    buffer[SECTOR_SIZE-2] = (uint8_t)((crc >> 16) & 0xFF);
-    buffer[SECTOR_SIZE-1] = (uint8_t)((crc >> 24) & 0xFF);
+    seal_meta(buffer);
+    sb_loaded = 1;
+    pending_records = 0;
+    scrub_unpersisted = 0;
+    pack_fill = 0;
+    pack_first = STORAGE_PACK_NONE;
 
-    // write to all mirrors
-    for (uint8_t i = 0; i < RAID_MIRRORS; i++) {
-        uint32_t meta_sector = log_sector + (i * RAID_OFFSET);
-        int rc = write_sector(meta_sector, buffer);
-        if (rc != DRIVER_OK) return STORAGE_ERR_DRIVER;
-    }
+    memset(msg_sector, 0, SECTOR_SIZE);
+    msg_count = 0;
+    msg_unflushed = 0;
+
+    // an empty, valid message log first, so a previous card's is not read back
+    seal_meta(msg_sector);
+    int rc = write_meta_mirrors(log_sector + 1, msg_sector);
+    if (rc != DRIVER_OK) return STORAGE_ERR_DRIVER;
 
-    if (active_driver->sync) active_driver->sync(active_driver);
+    // write to all mirrors
+    rc = write_meta_mirrors(log_sector, buffer);
+    if (rc != DRIVER_OK) return STORAGE_ERR_DRIVER;
     return STORAGE_OK;
 }
 
 /*### PUBLIC API ###*/
+static uint64_t get_scrub_cursor(void) {
+  return sb_get(sb_sector, 24, 8);
+}
+
+static void put_scrub_cursor(uint64_t cursor) {
+  sb_put_wide(sb_sector, 24, 6, cursor);
+}
+
 uint8_t setup_storage(void) {
+  if (active_driver->sector_size != SECTOR_SIZE)
+    return STORAGE_ERR_PARAM;   // built for another profile
+
   int rc = active_driver->init(active_driver);
   printf("[STORAGE] init: %d\r\n", rc);
-  return (rc == DRIVER_OK) ? STORAGE_OK : STORAGE_ERR_DRIVER;
+  if (rc != DRIVER_OK)
+    return STORAGE_ERR_DRIVER;
+
+  // a blank device has no valid superblock yet; init_log_sector() creates it
+  compute_raid_offset();
+  pending_records = 0;
+  if (RAID_OFFSET && load_superblock() != STORAGE_OK)
+    printf("[STORAGE] no valid superblock\r\n");
+  return STORAGE_OK;
 }
 
-uint8_t save_msg(uint8_t *msg) {
-  uint8_t buffer[SECTOR_SIZE];
-  uint16_t last_msg;
-  uint8_t is_first_full;
+uint8_t storage_revalidate(void) {
+  if (!active_driver)
+    return STORAGE_ERR_DRIVER;
+  // reloading would drop them: storage_flush() first
+  if (pending_records || pack_fill || msg_unflushed)
+    return STORAGE_ERR_PARAM;
+  return load_superblock();
+}
 
-  int rc = read_sector(log_sector, buffer);
-  if (rc != DRIVER_OK)
+void storage_set_commit_policy(const storage_commit_policy_t *policy) {
+  if (!policy) return;
+  commit_policy = *policy;
+  if (commit_policy.max_records == 0)
+    commit_policy.max_records = 1;
+}
+
+/* Publish the pending tail: one barrier, then the superblock mirrors */
+static uint8_t commit_pending(void) {
+  if (pending_records == 0)
+    return STORAGE_OK;
+  if (ec_k && ec_flush() != STORAGE_OK)
     return STORAGE_ERR_DRIVER;
 
-  is_first_full = buffer[5];
+  // barrier: data mirrors must be durable before the tail points past them
+  if (active_driver->sync && active_driver->sync(active_driver) != DRIVER_OK)
+    return STORAGE_ERR_DRIVER;
 
-  last_msg = ((uint16_t)buffer[3]) | ((uint16_t)buffer[4] << 8);
+  uint8_t rc = set_last_sector(&pending_last);
+  if (rc != STORAGE_OK)
+    return rc;
 
-  last_msg++;
+  pending_records = 0;
+  return STORAGE_OK;
+}
 
-  if (is_first_full) {
-    if (last_msg == SECTOR_SIZE) {
-      return STORAGE_ERR_LOG_FULL;
-    } else {
-      buffer[3] = (uint8_t)(last_msg & 0xFF);
-      buffer[4] = (uint8_t)((last_msg >> 8) & 0xFF);
+uint8_t storage_flush(void) {
+  if (!active_driver)
+    return STORAGE_ERR_DRIVER;
 
-      rc = write_sector(log_sector, buffer);
-      if (rc != DRIVER_OK)
-        return STORAGE_ERR_DRIVER;
+  uint8_t rc = msg_flush();
+  if (rc != STORAGE_OK)
+    return rc;
+  if (pack_fill && (rc = pack_emit()) != STORAGE_OK)
+    return rc;
+  return commit_pending();
+}
 
-      rc = read_sector(log_sector + 1, buffer);
-      if (rc != DRIVER_OK)
-        return STORAGE_ERR_DRIVER;
+static uint8_t commit_due(void) {
+  if (pending_records >= commit_policy.max_records)
+    return 1;
+  if (commit_policy.max_interval_ms && commit_policy.clock_ms &&
+      (uint32_t)(commit_policy.clock_ms() - window_start_ms) >= commit_policy.max_interval_ms)
+    return 1;
+  return 0;
+}
 
-      buffer[last_msg] = *msg;
+void storage_set_msg_policy(const storage_msg_policy_t *policy) {
+  if (policy)
+    msg_policy = *policy;
+}
 
-      rc = write_sector(log_sector + 1, buffer);
-      if (rc != DRIVER_OK)
-        return STORAGE_ERR_DRIVER;
-    }
+uint8_t msg_flush(void) {
+  if (!active_driver)
+    return STORAGE_ERR_DRIVER;
+  if (msg_unflushed == 0)
+    return STORAGE_OK;
+
+  // messages first, then the count that makes them visible
+  seal_meta(msg_sector);
+  if (write_meta_mirrors(log_sector + 1, msg_sector) != DRIVER_OK)
+    return STORAGE_ERR_DRIVER;
+
+  sb_sector[3] = (uint8_t)(msg_count & 0xFF);
+  sb_sector[4] = (uint8_t)((msg_count >> 8) & 0xFF);
+  sb_sector[5] = (msg_count == MSG_CAPACITY);
+  seal_meta(sb_sector);
+  if (write_meta_mirrors(log_sector, sb_sector) != DRIVER_OK)
+    return STORAGE_ERR_DRIVER;
+
+  msg_unflushed = 0;
+  return STORAGE_OK;
+}
+
+uint8_t save_msg(uint8_t *msg) {
+  if (!msg)
+    return STORAGE_ERR_PARAM;
+  if (!sb_loaded)
+    return STORAGE_ERR_META;
+  if (msg_count >= MSG_CAPACITY)
+    return STORAGE_ERR_LOG_FULL;
+
+  msg_sector[msg_count++] = *msg;
+  if (msg_unflushed++ == 0 && msg_policy.clock_ms)
+    msg_window_start_ms = msg_policy.clock_ms();
+
+  // flush on sector fill, count threshold or timeout
+  if (msg_count == MSG_CAPACITY)
+    return msg_flush();
+  if (msg_policy.max_pending && msg_unflushed >= msg_policy.max_pending)
+    return msg_flush();
+  if (msg_policy.max_interval_ms && msg_policy.clock_ms &&
+      (uint32_t)(msg_policy.clock_ms() - msg_window_start_ms) >= msg_policy.max_interval_ms)
+    return msg_flush();
+
+  return STORAGE_OK;
+}
+
+/* Next free logical sector, if nsectors more fit on every mirror */
+static uint8_t append_base(uint32_t nsectors, uint64_t *base) {
+  uint8_t rc;
+  uint64_t last_sector = 0;
+  if (pending_records) {
+    last_sector = pending_last; // superblock lags behind inside a commit window
   } else {
-    if (last_msg == SECTOR_SIZE) {
-      last_msg = 0;
-      is_first_full = 1;
+    rc = get_last_sector(&last_sector);
+    if (rc != STORAGE_OK)
+      return rc;
+  }
 
-      buffer[3] = (uint8_t)(last_msg & 0xFF);
-      buffer[4] = (uint8_t)((last_msg >> 8) & 0xFF);
-      buffer[5] = is_first_full;
+  // ✅ next logical sector to write (last written is inclusive)
+  *base = last_sector + 1;
 
-      rc = write_sector(log_sector, buffer);
-      if (rc != DRIVER_OK)
-        return STORAGE_ERR_DRIVER;
+  // the last row must fit in the slices
+  if (ec_k)
+    return ec_row_of(*base + (nsectors ? nsectors - 1 : 0)) < RAID_OFFSET ? STORAGE_OK
+                                                                          : STORAGE_ERR_FULL;
 
-      rc = read_sector(log_sector + 1, buffer);
-      if (rc != DRIVER_OK)
-        return STORAGE_ERR_DRIVER;
+  // every mirror copy must fit inside its own slice
+  for (uint8_t m = 0; m < RAID_MIRRORS; m++) {
+    uint64_t start_sector = *base + (m * RAID_OFFSET);
+    if (start_sector + nsectors > active_driver->total_sectors)
+      return STORAGE_ERR_FULL;
+    if (start_sector + nsectors > (m + 1) * RAID_OFFSET)
+      return STORAGE_ERR_FULL;
+  }
+  return STORAGE_OK;
+}
 
-      buffer[last_msg] = *msg;
+/* Submit the SAME formatted span to all mirrors as a single batch, so a
+ * batching driver keeps the copies in flight together. Nothing is synced
+ * here; storage_flush() issues the barrier. */
+static uint8_t write_span_mirrors(uint64_t lba, uint32_t n, const uint8_t *span) {
+  if (ec_k)
+    return ec_write_span(lba, n, span);
 
-      rc = write_sector(log_sector + 1, buffer);
-      if (rc != DRIVER_OK)
-        return STORAGE_ERR_DRIVER;
+  driver_write_t reqs[RAID_MIRRORS];
+  for (uint8_t m = 0; m < RAID_MIRRORS; m++) {
+    reqs[m].lba = lba + (m * RAID_OFFSET);
+    reqs[m].count = n;
+    reqs[m].buffer = span;
+  }
+  return write_batch(reqs, RAID_MIRRORS, 0) == DRIVER_OK ? STORAGE_OK : STORAGE_ERR_DRIVER;
+}
+
+/* Record nsectors appended at base */
+static void append_note(uint64_t base, uint32_t nsectors) {
+  // ✅ last written logical sector (inclusive), published on commit
+  pending_last = base + nsectors - 1;
+  if (pending_records++ == 0 && commit_policy.clock_ms)
+    window_start_ms = commit_policy.clock_ms();
+}
+
+/* Record nsectors appended at base, commit if the policy says so */
+static uint8_t append_done(uint64_t base, uint32_t nsectors) {
+  append_note(base, nsectors);
+  return commit_due() ? commit_pending() : STORAGE_OK;
+}
+
+/* Encode one record in whichever mode is smaller; 0 if neither fits in cap */
+static size_t encode_record(const uint8_t *rec, uint8_t *out, size_t cap) {
+  uint8_t tmp[CODEC_BOUND(SECTOR_SIZE)];
+  size_t rle = codec_encode(rec, PAYLOAD_SIZE, out + 1, cap ? cap - 1 : 0, CODEC_MODE_RLE);
+  size_t dlt = codec_encode(rec, PAYLOAD_SIZE, tmp, rle ? rle - 1 : (cap ? cap - 1 : 0),
+                            CODEC_MODE_DELTA);
+  if (dlt) {
+    out[0] = CODEC_MODE_DELTA;
+    memcpy(out + 1, tmp, dlt);
+    return dlt + 1;
+  }
+  if (rle) {
+    out[0] = CODEC_MODE_RLE;
+    return rle + 1;
+  }
+  return 0;
+}
+
+/* raid_u8bit_values() with compression: whole records per sector, never
+ * more sectors than the plain layout (bounds were checked for that) */
+static uint8_t raid_compressed(const uint8_t *buffer, uint32_t nrecords, uint8_t header,
+                               uint64_t base, uint32_t *written) {
+  uint8_t span[STORAGE_IO_SECTORS][SECTOR_SIZE];
+  const size_t cap = PAYLOAD_SIZE - 2;
+  uint32_t n = 0, out = 0;
+
+  for (uint32_t r = 0; r < nrecords;) {
+    uint8_t *sector_buffer = span[n];
+    uint8_t *payload = &sector_buffer[HEADER_SIZE];
+    size_t fill = 0;
+    uint32_t k = 0;
+
+    while (r + k < nrecords && k < 0xFF) {
+      size_t used = encode_record(&buffer[(size_t)(r + k) * PAYLOAD_SIZE],
+                                  &payload[2 + fill], cap - fill);
+      if (!used)
+        break;
+      fill += used;
+      k++;
+    }
+
+    if (k >= 2) {
+      payload[0] = header;
+      payload[1] = (uint8_t)k;
+      memset(&payload[2 + fill], 0, cap - fill);
+      seal_sector(sector_buffer, STORAGE_SECTOR_RLE);
     } else {
-      buffer[3] = (uint8_t)(last_msg & 0xFF);
-      buffer[4] = (uint8_t)((last_msg >> 8) & 0xFF);
-      buffer[last_msg] = *msg;
+      k = 1;  // sharing a sector buys nothing, store it plain
+      memcpy(payload, &buffer[(size_t)r * PAYLOAD_SIZE], PAYLOAD_SIZE);
+      seal_sector(sector_buffer, header);
+    }
+    r += k;
 
-      rc = write_sector(log_sector, buffer);
-      if (rc != DRIVER_OK)
-        return STORAGE_ERR_DRIVER;
+    if (++n == STORAGE_IO_SECTORS || r == nrecords) {
+      uint8_t rc = write_span_mirrors(base + out, n, span[0]);
+      if (rc != STORAGE_OK)
+        return rc;
+      out += n;
+      n = 0;
     }
   }
-
+  *written = out;
   return STORAGE_OK;
 }
 
+void storage_set_compression(uint8_t mode) {
+  compress_mode = mode;
+}
+
 uint8_t raid_u8bit_values(uint8_t *buffer, size_t len, uint8_t *header) {
   if (!active_driver)
     return STORAGE_ERR_DRIVER;
+  if (!buffer || !header || *header > STORAGE_HEADER_USER_MAX)
+    return STORAGE_ERR_PARAM;
+  if (len % PAYLOAD_SIZE != 0)
+    return STORAGE_ERR_PARAM;
+  uint32_t nsectors = (uint32_t)(len / PAYLOAD_SIZE);
 
-  uint8_t rc;
-  uint32_t last_sector = 0;
-  rc = get_last_sector(&last_sector);
+  uint64_t base;
+  uint8_t rc = append_base(nsectors, &base);
   if (rc != STORAGE_OK)
     return rc;
 
-  if (len % PAYLOAD_SIZE != 0)
+  if (compress_mode == STORAGE_COMPRESS_RLE) {
+    uint32_t written = 0;
+    rc = raid_compressed(buffer, nsectors, *header, base, &written);
+    if (rc != STORAGE_OK)
+      return rc;
+    return append_done(base, written);
+  }
+
+  // format each chunk once, every mirror writes the same buffer
+  uint8_t span[STORAGE_IO_SECTORS][SECTOR_SIZE];
+
+  for (uint32_t i = 0; i < nsectors;) {
+    uint32_t n = nsectors - i;
+    if (n > STORAGE_IO_SECTORS)
+      n = STORAGE_IO_SECTORS;
+
+    format_sectors(&buffer[(size_t)i * PAYLOAD_SIZE], n, *header, span[0]);
+    rc = write_span_mirrors(base + i, n, span[0]);
+    if (rc != STORAGE_OK)
+      return rc;
+    i += n;
+  }
+
+  return append_done(base, nsectors);
+}
+
+/* Typed samples as STORAGE_SECTOR_COLUMNS sectors: size the append first
+ * so a full log fails before anything is written */
+static uint8_t save_columns(const void *buffer, uint8_t type, uint32_t frames, uint8_t channels,
+                            const uint8_t *header) {
+  if (!active_driver)
+    return STORAGE_ERR_DRIVER;
+  if (!buffer || !header || *header > STORAGE_HEADER_USER_MAX)
+    return STORAGE_ERR_PARAM;
+  if (frames == 0 || channels == 0 || channels > COLUMNS_CHANNELS_MAX)
     return STORAGE_ERR_PARAM;
-  uint32_t nsectors = (uint32_t)(len / PAYLOAD_SIZE);
 
-  // ✅ next logical sector to write (last written is inclusive)
-  uint32_t base = last_sector + 1;
+  uint32_t nsectors = 0;
+  for (uint32_t f = 0; f < frames; nsectors++)
+    f += columns_fit(buffer, type, frames, channels, f, PAYLOAD_SIZE);
+
+  uint64_t base;
+  uint8_t rc = append_base(nsectors, &base);
+  if (rc != STORAGE_OK)
+    return rc;
+
+  uint8_t span[STORAGE_IO_SECTORS][SECTOR_SIZE];
+  uint32_t n = 0, out = 0;
+  for (uint32_t f = 0; f < frames;) {
+    uint32_t k = columns_fit(buffer, type, frames, channels, f, PAYLOAD_SIZE);
+    columns_encode(buffer, type, channels, f, k, *header, &span[n][HEADER_SIZE], PAYLOAD_SIZE);
+    seal_sector(span[n], STORAGE_SECTOR_COLUMNS);
+    f += k;
+
+    if (++n == STORAGE_IO_SECTORS || f == frames) {
+      rc = write_span_mirrors(base + out, n, span[0]);
+      if (rc != STORAGE_OK)
+        return rc;
+      out += n;
+      n = 0;
+    }
+  }
+  return append_done(base, nsectors);
+}
+
+uint8_t save_u16bit_values(const uint16_t *buffer, uint32_t frames, uint8_t channels,
+                           uint8_t *header) {
+  return save_columns(buffer, 2, frames, channels, header);
+}
+
+uint8_t save_16bit_values(const int16_t *buffer, uint32_t frames, uint8_t channels,
+                          uint8_t *header) {
+  return save_columns(buffer, 2 | COLUMNS_SIGNED, frames, channels, header);
+}
+
+uint8_t save_u32bit_values(const uint32_t *buffer, uint32_t frames, uint8_t channels,
+                           uint8_t *header) {
+  return save_columns(buffer, 4, frames, channels, header);
+}
+
+uint8_t save_32bit_values(const int32_t *buffer, uint32_t frames, uint8_t channels,
+                          uint8_t *header) {
+  return save_columns(buffer, 4 | COLUMNS_SIGNED, frames, channels, header);
+}
+
+uint8_t storage_reserve(uint32_t n_sectors, storage_reservation_t *resv) {
+  if (!active_driver)
+    return STORAGE_ERR_DRIVER;
+  if (!resv || n_sectors == 0 || n_sectors > STORAGE_RESERVE_SECTORS || resv_count)
+    return STORAGE_ERR_PARAM;
+
+  // fail now rather than after the producer has filled the buffers
+  uint64_t base;
+  uint8_t rc = append_base(n_sectors, &base);
+  if (rc != STORAGE_OK)
+    return rc;
+
+  resv_count = n_sectors;
+  resv->payload = &resv_buf[0][HEADER_SIZE];
+  resv->stride = SECTOR_SIZE;
+  resv->count = n_sectors;
+  return STORAGE_OK;
+}
+
+uint8_t storage_commit(const uint8_t *header) {
+  if (!active_driver)
+    return STORAGE_ERR_DRIVER;
+  if (!header || *header > STORAGE_HEADER_USER_MAX || !resv_count)
+    return STORAGE_ERR_PARAM;
+
+  uint32_t n = resv_count;
+  uint64_t base;
+  uint8_t rc = append_base(n, &base);
+  if (rc != STORAGE_OK)
+    return rc;
+
+  // payloads were filled in place: one CRC per sector, no copies
+  for (uint32_t s = 0; s < n; s++)
+    seal_sector(resv_buf[s], *header);
+
+  rc = write_span_mirrors(base, n, resv_buf[0]);
+  if (rc != STORAGE_OK)
+    return rc;   // reservation stays open, the commit can be retried
+
+  resv_count = 0;
+  return append_done(base, n);
+}
+
+void storage_abort(void) {
+  resv_count = 0;
+}
+
+/* Pad, seal and append the staged packed sector; the caller commits */
+static uint8_t pack_emit(void) {
+  uint8_t *stream = &pack_sector[HEADER_SIZE + 2];
+
+  if (pack_fill < PACK_AREA) {
+    stream[pack_fill] = STORAGE_PACK_PAD;
+    memset(&stream[pack_fill + 1], 0, PACK_AREA - pack_fill - 1);
+  }
+  pack_sector[HEADER_SIZE] = (uint8_t)(pack_first & 0xFF);
+  pack_sector[HEADER_SIZE + 1] = (uint8_t)(pack_first >> 8);
 
-  // Write the SAME logical span to all mirrors
-  for (uint8_t i = 0; i < RAID_MIRRORS; i++) {
-    uint32_t start_sector = base + (i * RAID_OFFSET);
-    rc = save_u8bit_values(buffer, len, header, &start_sector);
+  uint64_t base;
+  uint8_t rc = append_base(1, &base);
+  if (rc != STORAGE_OK)
+    return rc;
+  seal_sector(pack_sector, STORAGE_SECTOR_PACKED);
+  rc = write_span_mirrors(base, 1, pack_sector);
+  if (rc != STORAGE_OK)
+    return rc;
+  append_note(base, 1);
+
+  pack_fill = 0;
+  pack_first = STORAGE_PACK_NONE;
+  return STORAGE_OK;
+}
+
+static uint8_t pack_put(const uint8_t *p, size_t n, uint8_t *emitted) {
+  while (n) {
+    size_t k = PACK_AREA - pack_fill;
+    if (k > n)
+      k = n;
+    memcpy(&pack_sector[HEADER_SIZE + 2 + pack_fill], p, k);
+    pack_fill += (uint16_t)k;
+    p += k;
+    n -= k;
+
+    if (pack_fill == PACK_AREA) {
+      uint8_t rc = pack_emit();
+      if (rc != STORAGE_OK)
+        return rc;
+      *emitted = 1;
+    }
+  }
+  return STORAGE_OK;
+}
+
+uint8_t storage_pack_record(uint8_t type, const uint8_t *data, uint16_t len) {
+  if (!active_driver)
+    return STORAGE_ERR_DRIVER;
+  if (type == STORAGE_PACK_PAD || (!data && len))
+    return STORAGE_ERR_PARAM;
+  if (!sb_loaded)
+    return STORAGE_ERR_META;
+
+  const uint8_t hdr[STORAGE_PACK_REC_HDR] = { type, (uint8_t)(len & 0xFF), (uint8_t)(len >> 8) };
+  uint8_t emitted = 0;
+
+  if (pack_first == STORAGE_PACK_NONE)
+    pack_first = pack_fill;
+  uint8_t rc = pack_put(hdr, sizeof(hdr), &emitted);
+  if (rc == STORAGE_OK)
+    rc = pack_put(data, len, &emitted);
+  if (rc != STORAGE_OK)
+    return rc;
+
+  // commit whole sectors only, the one being filled stays in RAM
+  return (emitted && commit_due()) ? commit_pending() : STORAGE_OK;
+}
+
+void storage_set_read_mode(uint8_t mode) {
+  read_mode = mode;
+}
+
+uint32_t storage_mirror_errors(uint8_t mirror) {
+  return (mirror < slices) ? mirror_errors[mirror] : 0;
+}
+
+uint8_t read_u8bit_values(uint64_t logical_sector, uint32_t count, uint8_t *out,
+                          uint8_t *header_out) {
+  if (!active_driver)
+    return STORAGE_ERR_DRIVER;
+  if (!out || count == 0 || logical_sector < log_sector + 2)
+    return STORAGE_ERR_PARAM;
+
+  uint8_t rc;
+  uint64_t last_sector = 0;
+  if (pending_records) {
+    last_sector = pending_last;
+  } else {
+    rc = get_last_sector(&last_sector);
+    if (rc != STORAGE_OK)
+      return rc;
+  }
+  if (logical_sector + count - 1 > last_sector)
+    return STORAGE_ERR_PARAM;
+
+  uint8_t span[STORAGE_IO_SECTORS][SECTOR_SIZE];
+  uint8_t order[RAID_MIRRORS];
+
+  for (uint32_t i = 0; i < count;) {
+    uint32_t n = count - i;
+    if (n > STORAGE_IO_SECTORS)
+      n = STORAGE_IO_SECTORS;
+    uint64_t logical = logical_sector + i;
+
+    if (ec_k) {
+      for (uint32_t s = 0; s < n; s++) {
+        rc = ec_read(logical + s, last_sector, span[s]);
+        if (rc != STORAGE_OK)
+          return rc;
+      }
+    } else if (read_mode == STORAGE_READ_VOTE) {
+      for (uint32_t s = 0; s < n; s++) {
+        rc = read_voted(logical + s, span[s]);
+        if (rc != STORAGE_OK)
+          return rc;
+      }
+    } else {
+      // one span from the preferred mirror, the others per bad sector
+      mirror_order(order);
+      uint8_t primary = order[0];
+      int rcr = read_sectors(logical + (primary * RAID_OFFSET), n, span[0]);
+
+      for (uint32_t s = 0; s < n; s++) {
+        if (rcr == DRIVER_OK && data_crc_ok(span[s]))
+          continue;
+        mirror_errors[primary]++;
+
+        uint8_t k = 1;
+        for (; k < RAID_MIRRORS; k++) {
+          uint8_t m = order[k];
+          if (read_sector(logical + s + (m * RAID_OFFSET), span[s]) == DRIVER_OK &&
+              data_crc_ok(span[s]))
+            break;
+          mirror_errors[m]++;
+        }
+        if (k == RAID_MIRRORS)
+          return STORAGE_ERR_CORRUPT;
+      }
+    }
+
+    for (uint32_t s = 0; s < n; s++) {
+      memcpy(&out[(size_t)(i + s) * PAYLOAD_SIZE], &span[s][HEADER_SIZE], PAYLOAD_SIZE);
+      if (header_out)
+        header_out[i + s] = span[s][0];
+    }
+    i += n;
+  }
+  return STORAGE_OK;
+}
+
+uint8_t read_u8bit_records(uint64_t logical_sector, uint32_t count, uint8_t *out,
+                           uint32_t max_records, uint8_t *header_out, uint32_t *records) {
+  if (!out || !records)
+    return STORAGE_ERR_PARAM;
+
+  uint8_t payload[PAYLOAD_SIZE];
+  uint8_t header;
+  *records = 0;
+  for (uint32_t s = 0; s < count; s++) {
+    uint8_t rc = read_u8bit_values(logical_sector + s, 1, payload, &header);
     if (rc != STORAGE_OK)
       return rc;
+
+    uint32_t n = *records;
+    uint32_t k = (header == STORAGE_SECTOR_RLE) ? payload[1] : 1;
+    if (k > max_records - n)
+      return STORAGE_ERR_FULL;
+    if (header != STORAGE_SECTOR_RLE)
+      memcpy(&out[(size_t)n * PAYLOAD_SIZE], payload, PAYLOAD_SIZE);
+    else if (codec_sector_decode(payload, PAYLOAD_SIZE, PAYLOAD_SIZE, &out[(size_t)n * PAYLOAD_SIZE],
+                                 k, &header) < 0)
+      return STORAGE_ERR_CORRUPT;
+    for (uint32_t r = 0; header_out && r < k; r++)
+      header_out[n + r] = header;
+    *records = n + k;
+  }
+  return STORAGE_OK;
+}
+
+/* Check one parity row: rebuild and rewrite bad data columns, then
+ * rewrite parity that no longer matches them. Every written column
+ * counts, commit window included, as the parity covers those too. */
+static uint8_t ec_scrub_row(uint64_t row, uint64_t last, uint32_t *budget, uint8_t *wrote) {
+  uint8_t par[EC_PARITY_MAX][SECTOR_SIZE];
+  uint8_t buf[SECTOR_SIZE];
+  uint64_t first = 2 + (row - 2) * ec_k;
+  uint8_t width = (last - first + 1 < ec_k) ? (uint8_t)(last - first + 1) : ec_k;
+  uint8_t lost = 0;
+
+  // the open row's parity may still be in RAM only
+  if (row == ec_row && ec_flush() != STORAGE_OK)
+    return STORAGE_ERR_DRIVER;
+  memset(par, 0, sizeof(par));
+  for (uint8_t c = 0; c < width; c++) {
+    if (read_sector(ec_lba(row, c), buf) != DRIVER_OK || !data_crc_ok(buf)) {
+      mirror_errors[c]++;
+      if (ec_rebuild(row, last, c, buf) != STORAGE_OK) {
+        scrub_stats.unrecoverable++;
+        lost = 1;
+        continue;
+      }
+      if (write_sector(ec_lba(row, c), buf) != DRIVER_OK)
+        return STORAGE_ERR_DRIVER;
+      scrub_stats.repaired++;
+      *wrote = 1;
+      if (*budget) (*budget)--;
+    }
+    for (uint8_t j = 0; j < ec_m; j++)
+      ec_mul_add(par[j], buf, SECTOR_SIZE, ec_coef(j, c));
+  }
+  scrub_stats.checked += width;
+  scrub_unpersisted += width;
+  if (lost)
+    return STORAGE_OK;
+
+  for (uint8_t j = 0; j < ec_m; j++) {
+    if (read_sector(ec_lba(row, ec_k + j), buf) == DRIVER_OK &&
+        memcmp(buf, par[j], SECTOR_SIZE) == 0)
+      continue;
+    if (write_sector(ec_lba(row, ec_k + j), par[j]) != DRIVER_OK)
+      return STORAGE_ERR_DRIVER;
+    scrub_stats.repaired++;
+    *wrote = 1;
+    if (*budget) (*budget)--;
+  }
+  return STORAGE_OK;
+}
+
+uint8_t storage_scrub_step(uint32_t budget) {
+  if (!active_driver)
+    return STORAGE_ERR_DRIVER;
+
+  // only committed data; a sector inside the commit window may still move
+  uint64_t last_sector = 0;
+  uint8_t rc = get_last_sector(&last_sector);
+  if (rc != STORAGE_OK)
+    return rc;
+
+  const uint64_t first = log_sector + 2;
+  if (last_sector < first)
+    return STORAGE_OK;
+
+  uint8_t copies[RAID_MIRRORS][SECTOR_SIZE];
+  uint8_t valid[RAID_MIRRORS];
+  uint8_t wrote = 0;
+  uint64_t cursor = get_scrub_cursor();
+  if (cursor < first || cursor > last_sector)
+    cursor = first;
+
+  // parity groups go a row at a time, from the row's first column
+  const uint8_t cost = ec_k ? ec_k + ec_m : RAID_MIRRORS;
+  const uint64_t written = pending_records ? pending_last : last_sector;
+  if (ec_k)
+    cursor -= ec_col_of(cursor);
+
+  // reads up front; repairs use up what is left but finish past it (storage.h)
+  while (budget >= cost) {
+    budget -= cost;
+    uint64_t next = cursor + 1;
+
+    if (ec_k) {
+      rc = ec_scrub_row(ec_row_of(cursor), written, &budget, &wrote);
+      if (rc != STORAGE_OK)
+        return rc;
+      next = cursor + ec_k;
+    } else {
+      int8_t best = vote_sector(cursor, copies, valid);
+      if (best < 0) {
+        scrub_stats.unrecoverable++;
+      } else {
+        for (uint8_t m = 0; m < RAID_MIRRORS; m++) {
+          if (valid[m] && memcmp(copies[m], copies[best], SECTOR_SIZE) == 0)
+            continue;
+          if (write_sector(cursor + (m * RAID_OFFSET), copies[best]) != DRIVER_OK)
+            return STORAGE_ERR_DRIVER;
+          scrub_stats.repaired++;
+          wrote = 1;
+          if (budget) budget--;
+        }
+      }
+      scrub_stats.checked++;
+      scrub_unpersisted++;
+    }
+
+    if (next > last_sector) {
+      cursor = first;
+      scrub_stats.passes++;
+      break;
+    }
+    cursor = next;
   }
 
-  // ✅ update last written logical sector (inclusive)
-  uint32_t new_last = base + nsectors - 1;
-  return set_last_sector(&new_last);
+  put_scrub_cursor(cursor);
+  scrub_stats.cursor = cursor;
+
+  // the superblock batch syncs the repairs too; otherwise sync them here
+  if (scrub_unpersisted >= STORAGE_SCRUB_PERSIST) {
+    seal_meta(sb_sector);
+    if (write_meta_mirrors(log_sector, sb_sector) != DRIVER_OK)
+      return STORAGE_ERR_DRIVER;
+    scrub_unpersisted = 0;
+  } else if (wrote && active_driver->sync &&
+             active_driver->sync(active_driver) != DRIVER_OK) {
+    return STORAGE_ERR_DRIVER;
+  }
+  return STORAGE_OK;
+}
+
+void storage_scrub_stats(storage_scrub_stats_t *stats) {
+  if (stats)
+    *stats = scrub_stats;
 }
 
 uint8_t save_u8bit_values(uint8_t *buffer, size_t len, uint8_t *header,
-                          uint32_t *start_raid_sector) {
-  if (!buffer || !header || !active_driver)
+                          uint64_t *start_raid_sector) {
+  if (!buffer || !header || !active_driver || *header > STORAGE_HEADER_USER_MAX)
     return STORAGE_ERR_PARAM;
   if (len % PAYLOAD_SIZE != 0)
     return STORAGE_ERR_PARAM;
 
-  uint16_t num_of_sectors = len / PAYLOAD_SIZE;
+  uint64_t num_of_sectors = len / PAYLOAD_SIZE;
 
   // local cursor (VALUE), first write goes exactly to *start_raid_sector
-  uint32_t target = *start_raid_sector;
+  uint64_t target = *start_raid_sector;
 
   // derive mirror slice bounds from RAID_OFFSET (keeps mirrors isolated)
-  uint32_t mirror_index = target / RAID_OFFSET;
-  uint32_t slice_start = mirror_index * RAID_OFFSET;
-  uint32_t slice_end = slice_start + RAID_OFFSET; // exclusive
-
-  uint8_t sector_buffer[SECTOR_SIZE];
-
-  for (uint16_t i = 0; i < num_of_sectors; i++) {
-    if (target >= active_driver->total_sectors)
-      return STORAGE_ERR_FULL;
-    if (target >= slice_end)
-      return STORAGE_ERR_FULL;
+  uint64_t mirror_index = target / RAID_OFFSET;
+  uint64_t slice_start = mirror_index * RAID_OFFSET;
+  uint64_t slice_end = slice_start + RAID_OFFSET; // exclusive
 
-    // clear
-    for (uint16_t j = 0; j < SECTOR_SIZE; j++)
-      sector_buffer[j] = 0;
+  if (target + num_of_sectors > active_driver->total_sectors)
+    return STORAGE_ERR_FULL;
+  if (target + num_of_sectors > slice_end)
+    return STORAGE_ERR_FULL;
 
-    // header
-    sector_buffer[0] = *header;
+  // format up to STORAGE_IO_SECTORS sectors, then write them in one call
+  uint8_t span[STORAGE_IO_SECTORS][SECTOR_SIZE];
 
-    // payload
-    for (uint16_t k = 0; k < PAYLOAD_SIZE; k++)
-      sector_buffer[1 + k] = buffer[i * PAYLOAD_SIZE + k];
+  for (uint64_t i = 0; i < num_of_sectors;) {
+    uint32_t n = STORAGE_IO_SECTORS;
+    if (num_of_sectors - i < n)
+      n = (uint32_t)(num_of_sectors - i);
 
-    // CRC (end of sector)
-    uint32_t crc = crc32(sector_buffer, HEADER_SIZE + PAYLOAD_SIZE);
-    const uint16_t off = SECTOR_SIZE - 4;
-    sector_buffer[off + 0] = (uint8_t)(crc & 0xFF);
-    sector_buffer[off + 1] = (uint8_t)((crc >> 8) & 0xFF);
-    sector_buffer[off + 2] = (uint8_t)((crc >> 16) & 0xFF);
-    sector_buffer[off + 3] = (uint8_t)((crc >> 24) & 0xFF);
+    format_sectors(&buffer[(size_t)i * PAYLOAD_SIZE], n, *header, span[0]);
 
-    int rcw = write_sector(target, sector_buffer);
+    int rcw = write_sectors(target, n, span[0]);
     if (rcw != DRIVER_OK)
       return STORAGE_ERR_DRIVER;
 
-    target++; // advance for next sector within this mirror slice
+    target += n; // advance within this mirror slice
+    i += n;
   }
 
   // hand back next-free sector in this mirror slice
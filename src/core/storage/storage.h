@@ -4,17 +4,217 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/* ---- Return codes ---- */
+#define STORAGE_OK 0
+#define STORAGE_ERR_DRIVER 1
+#define STORAGE_ERR_PARAM 2
+#define STORAGE_ERR_FULL 3
+#define STORAGE_ERR_LOG_FULL 4
+#define STORAGE_ERR_META 5
+#define STORAGE_ERR_CORRUPT 6
+
+/* ---- Sector types ----
+ * Header values above STORAGE_HEADER_USER_MAX mark sectors the library
+ * formats itself; the append APIs reject them as user headers. */
+#define STORAGE_HEADER_USER_MAX 0xEF
+#define STORAGE_SECTOR_PACKED 0xF1
+#define STORAGE_SECTOR_RLE 0xF2      // whole records, compressed, see codec.h
+#define STORAGE_SECTOR_COLUMNS 0xF3  // typed samples, column-wise, see columns.h
+
+/* ---- Compression for raid_u8bit_values() ---- */
+#define STORAGE_COMPRESS_OFF 0
+#define STORAGE_COMPRESS_RLE 1
+
+/* ---- Packed sectors (STORAGE_SECTOR_PACKED) ----
+ * payload = [u16 first][record stream ...]
+ * first is the stream offset of the first record that starts in this
+ * sector (STORAGE_PACK_NONE if it only continues one). A record is
+ * [u8 type][u16 len][len bytes], all little-endian; records run on into
+ * the next packed sector. Type STORAGE_PACK_PAD ends the sector early. */
+#define STORAGE_PACK_NONE 0xFFFF
+#define STORAGE_PACK_PAD 0x00
+#define STORAGE_PACK_REC_HDR 3
+
+/* ---- Read modes for read_u8bit_values() ---- */
+#define STORAGE_READ_FAST 0   // least-failing mirror only, others on error
+#define STORAGE_READ_VOTE 1   // every mirror, majority of the valid copies
+
+/**
+ * @brief Group commit policy for raid_u8bit_values().
+ *
+ * Appends inside a window only write the data mirrors. The window is
+ * committed (one sync barrier, then the superblock mirrors once) when
+ * max_records appends are pending or max_interval_ms has passed since the
+ * first of them. The interval is checked on append, so call storage_flush()
+ * when going idle. The default { 1, 0, NULL } commits every append.
+ */
+typedef struct {
+  uint32_t max_records;           ///< Commit after this many appends (0 is treated as 1)
+  uint32_t max_interval_ms;       ///< Commit once the window is this old (0 = off)
+  uint32_t (*clock_ms)(void);     ///< Millisecond time source, needed for max_interval_ms
+} storage_commit_policy_t;
+
+/**
+ * @brief Flush policy for the buffered message log.
+ *
+ * save_msg() only updates a RAM copy of the log sector. It is written out
+ * (CRC sealed, all mirrors, then the superblock count) when the sector
+ * fills, on msg_flush()/storage_flush(), after max_pending messages or once
+ * max_interval_ms has passed since the first unflushed one. 0 disables a
+ * limit; the default flushes on sector fill only.
+ */
+typedef struct {
+  uint16_t max_pending;           ///< Flush after this many unflushed messages (0 = off)
+  uint32_t max_interval_ms;       ///< Flush once the oldest unflushed message is this old (0 = off)
+  uint32_t (*clock_ms)(void);     ///< Millisecond time source, needed for max_interval_ms
+} storage_msg_policy_t;
+
+/**
+ * @brief Running totals of the background scrubber.
+ */
+typedef struct {
+  uint64_t cursor;                ///< Next logical sector to check
+  uint32_t checked;               ///< Logical sectors checked
+  uint32_t repaired;              ///< Mirror copies rewritten from the voted copy
+  uint32_t unrecoverable;         ///< Logical sectors with no valid copy left
+  uint32_t passes;                ///< Completed walks over the whole log
+} storage_scrub_stats_t;
+
+/**
+ * @brief Sectors handed out by storage_reserve() for in-place filling.
+ *
+ * Sector i's payload is PAYLOAD_SIZE bytes at payload + i * stride; the
+ * bytes in between belong to the header and CRC and must not be written.
+ */
+typedef struct {
+  uint8_t *payload;               ///< Payload of the first reserved sector
+  uint32_t stride;                ///< Bytes from one sector's payload to the next
+  uint32_t count;                 ///< Reserved sectors
+} storage_reservation_t;
+
 uint8_t setup_storage(void);
+uint8_t storage_revalidate(void);  // re-read the superblock after another writer; flush first
+
+/**
+ * @brief Redundancy for the next init_log_sector() (default mirrored).
+ *
+ * data 0 (with parity 0) writes every sector RAID_MIRRORS times. Otherwise
+ * data sectors (2..EC_DATA_MAX) form a row with parity sectors (1 = XOR,
+ * 2 = XOR + Reed-Solomon, see erasure.h) and survives parity lost
+ * sectors per row. A row's parity is written when the row fills and at
+ * every commit, so appends take (data + parity) / data writes per sector
+ * when a commit window spans whole rows (storage_set_commit_policy()),
+ * and up to 1 + parity per append when every append commits. The layout is recorded in the superblock; a card is
+ * always read with the layout it was formatted with.
+ */
+uint8_t storage_set_redundancy(uint8_t data, uint8_t parity);
 uint8_t init_log_sector(void);
 uint8_t save_msg(uint8_t* msg);
+uint8_t msg_flush(void);
+void storage_set_msg_policy(const storage_msg_policy_t *policy);
+
+void storage_set_commit_policy(const storage_commit_policy_t *policy);
+uint8_t storage_flush(void);   // make every pending append and message durable
 
 uint8_t raid_u8bit_values(uint8_t* buffer, size_t len, uint8_t* header);
-uint8_t save_u8bit_values(uint8_t* buffer, size_t len, uint8_t* header, uint32_t *start_raid_sector);
-/*uint8_t save_8bit_values(int8_t* buffer);
 
-uint8_t save_u16bit_values(uint16_t* buffer);
-uint8_t save_16bit_values(int16_t* buffer);
+/**
+ * @brief Compress raid_u8bit_values() payloads (default off).
+ *
+ * With STORAGE_COMPRESS_RLE the PAYLOAD_SIZE records of each call are
+ * RLE (or delta+RLE, whichever is smaller) encoded and as many whole
+ * records as fit go into one STORAGE_SECTOR_RLE sector. A record that
+ * does not compress into a shared sector is stored as a plain sector, so
+ * a call never takes more sectors than uncompressed.
+ * read_u8bit_records() returns the records; read_u8bit_values() returns
+ * such sectors as stored (codec_sector_decode() decodes them).
+ */
+void storage_set_compression(uint8_t mode);
+
+/**
+ * @brief Zero-copy append: reserve, fill the payloads in place, commit.
+ *
+ * storage_commit() adds the header and CRC to each reserved sector once
+ * and writes the same buffer to every mirror, then follows the commit
+ * policy like raid_u8bit_values(). One reservation (at most
+ * STORAGE_RESERVE_SECTORS) can be open at a time; storage_abort() drops it.
+ */
+uint8_t storage_reserve(uint32_t n_sectors, storage_reservation_t* resv);
+uint8_t storage_commit(const uint8_t* header);
+void storage_abort(void);
+
+/**
+ * @brief Append a variable-length record to the packed record stream.
+ *
+ * Records are staged in RAM and packed back to back into
+ * STORAGE_SECTOR_PACKED sectors, which are appended (and follow the
+ * commit policy) as they fill. storage_flush() pads and writes a partly
+ * filled sector, so flushing after every few records wastes space.
+ * type 0 is reserved for padding.
+ */
+uint8_t storage_pack_record(uint8_t type, const uint8_t* data, uint16_t len);
+
+/**
+ * @brief Read back count logical sectors starting at logical_sector.
+ *
+ * out receives count * PAYLOAD_SIZE bytes, header_out (may be NULL) one
+ * header per sector. Appends still inside a commit window are readable;
+ * sectors past the tail are rejected with STORAGE_ERR_PARAM, and a sector
+ * with no valid copy on any mirror fails with STORAGE_ERR_CORRUPT. On a
+ * parity card a bad sector is rebuilt from the rest of its row.
+ */
+uint8_t read_u8bit_values(uint64_t logical_sector, uint32_t count, uint8_t* out, uint8_t* header_out);
+
+/**
+ * @brief read_u8bit_values() with compressed sectors expanded.
+ *
+ * A STORAGE_SECTOR_RLE sector gives back the records it holds, each with
+ * the user header it was written with; any other sector is one record as
+ * stored. Up to max_records records of PAYLOAD_SIZE bytes go to out and
+ * header_out (may be NULL), *records says how many. STORAGE_ERR_FULL if
+ * they do not fit, STORAGE_ERR_CORRUPT for a sector that does not decode.
+ */
+uint8_t read_u8bit_records(uint64_t logical_sector, uint32_t count, uint8_t* out,
+                           uint32_t max_records, uint8_t* header_out, uint32_t* records);
+void storage_set_read_mode(uint8_t mode);
+uint32_t storage_mirror_errors(uint8_t mirror);  // failed reads + CRC errors seen, per slice
+
+/**
+ * @brief Check and repair the next logical sectors, within about budget sector I/Os.
+ *
+ * Each logical sector costs RAID_MIRRORS reads plus one write per mirror
+ * copy that is unreadable, corrupt or outvoted; those are rewritten from
+ * the majority (or only) valid copy. Parity cards check a row at a time
+ * (data + parity reads), rebuild bad data sectors and rewrite stale
+ * parity. A sector or row is only started while its reads fit in what is
+ * left of budget, but its repairs are always finished, so the last one of
+ * a step can go over budget by its writes: at most RAID_MIRRORS - 1, or
+ * 2 * parity on a parity row. Parity rows also read the rest of the row
+ * to rebuild a bad sector, and write the open row's parity if a commit
+ * window still holds it in RAM; neither is counted. The cursor lives in
+ * the superblock, goes out with the next commit and at least every
+ * STORAGE_SCRUB_PERSIST sectors, so scrubbing resumes where it stopped
+ * after a reboot.
+ */
+uint8_t storage_scrub_step(uint32_t budget);
+void storage_scrub_stats(storage_scrub_stats_t *stats);
+uint8_t save_u8bit_values(uint8_t* buffer, size_t len, uint8_t* header, uint64_t *start_raid_sector);
+/*uint8_t save_8bit_values(int8_t* buffer);*/
+
+/**
+ * @brief Append frames of channels interleaved samples, stored column-wise.
+ *
+ * buffer holds frames * channels samples, frame after frame. Each
+ * STORAGE_SECTOR_COLUMNS sector takes as many whole frames as fit once
+ * every channel is delta, delta-of-delta or plainly zigzag bit-packed,
+ * so smooth signals need a fraction of the raw sectors. The call is one
+ * append under the commit policy; channels is at most COLUMNS_CHANNELS_MAX.
+ * read_u8bit_values() returns the sectors as stored; decode them with
+ * columns_decode().
+ */
+uint8_t save_u16bit_values(const uint16_t* buffer, uint32_t frames, uint8_t channels, uint8_t* header);
+uint8_t save_16bit_values(const int16_t* buffer, uint32_t frames, uint8_t channels, uint8_t* header);
 
-uint8_t save_u32bit_values(uint32_t* buffer);
-uint8_t save_32bit_values(int32_t* buffer);*/
+uint8_t save_u32bit_values(const uint32_t* buffer, uint32_t frames, uint8_t channels, uint8_t* header);
+uint8_t save_32bit_values(const int32_t* buffer, uint32_t frames, uint8_t channels, uint8_t* header);
 #endif /* STORAGE_H */
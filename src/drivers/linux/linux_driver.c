@@ -1,29 +1,33 @@
 #define _GNU_SOURCE
 #include <unistd.h>
 
+#include "config.h"
 #include "driver.h"
+#include "linux_driver.h"
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <errno.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <linux/fs.h>
 
-typedef struct {
-    int fd;
-    const char *path;
-} linux_ctx_t;
-
 static int linux_init(driver_t *self) {
     linux_ctx_t *ctx = (linux_ctx_t *)self->ctx;
-    ctx->fd = open(ctx->path, O_RDWR | O_SYNC);
+    /* no O_SYNC: the storage layer issues explicit sync() barriers */
+    ctx->fd = open(ctx->path, O_RDWR);
     if (ctx->fd < 0) {
         perror("[linux_driver] open");
         return DRIVER_ERR_INIT;
     }
 
     uint64_t bytes = 0;
-    if (ioctl(ctx->fd, BLKGETSIZE64, &bytes) == -1) {
+    struct stat st;
+    if (ioctl(ctx->fd, BLKGETSIZE64, &bytes) == -1 &&
+        fstat(ctx->fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        bytes = (uint64_t)st.st_size;   // regular image file
+    }
+    if (bytes == 0) {
         perror("[linux_driver] ioctl(BLKGETSIZE64)");
         self->total_size_bytes = 0;
         self->total_sectors = 0;
@@ -39,7 +43,7 @@ static int linux_init(driver_t *self) {
     return DRIVER_OK;
 }
 
-static int linux_read(driver_t *self, uint32_t lba, uint8_t *buf) {
+static int linux_read(driver_t *self, uint64_t lba, uint8_t *buf) {
     linux_ctx_t *ctx = (linux_ctx_t *)self->ctx;
     if (!buf) return DRIVER_ERR_PARAM;
     off_t offset = (off_t)lba * self->sector_size;
@@ -47,7 +51,7 @@ static int linux_read(driver_t *self, uint32_t lba, uint8_t *buf) {
     return (rc == (ssize_t)self->sector_size) ? DRIVER_OK : DRIVER_ERR_IO;
 }
 
-static int linux_write(driver_t *self, uint32_t lba, const uint8_t *buf) {
+static int linux_write(driver_t *self, uint64_t lba, const uint8_t *buf) {
     linux_ctx_t *ctx = (linux_ctx_t *)self->ctx;
     if (!buf) return DRIVER_ERR_PARAM;
     off_t offset = (off_t)lba * self->sector_size;
@@ -55,6 +59,33 @@ static int linux_write(driver_t *self, uint32_t lba, const uint8_t *buf) {
     return (rc == (ssize_t)self->sector_size) ? DRIVER_OK : DRIVER_ERR_IO;
 }
 
+/* pread/pwrite may legally transfer less than asked for large spans */
+static int linux_pio(int fd, uint8_t *buf, size_t len, off_t offset, int write) {
+    while (len) {
+        ssize_t rc = write ? pwrite(fd, buf, len, offset) : pread(fd, buf, len, offset);
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) return DRIVER_ERR_IO;
+        buf += rc;
+        len -= (size_t)rc;
+        offset += rc;
+    }
+    return DRIVER_OK;
+}
+
+static int linux_read_blocks(driver_t *self, uint64_t lba, uint32_t count, uint8_t *buf) {
+    linux_ctx_t *ctx = (linux_ctx_t *)self->ctx;
+    if (!buf) return DRIVER_ERR_PARAM;
+    return linux_pio(ctx->fd, buf, (size_t)count * self->sector_size,
+                     (off_t)lba * self->sector_size, 0);
+}
+
+static int linux_write_blocks(driver_t *self, uint64_t lba, uint32_t count, const uint8_t *buf) {
+    linux_ctx_t *ctx = (linux_ctx_t *)self->ctx;
+    if (!buf) return DRIVER_ERR_PARAM;
+    return linux_pio(ctx->fd, (uint8_t *)buf, (size_t)count * self->sector_size,
+                     (off_t)lba * self->sector_size, 1);
+}
+
 static int linux_sync(driver_t *self) {
     linux_ctx_t *ctx = (linux_ctx_t *)self->ctx;
     return (fsync(ctx->fd) == 0) ? DRIVER_OK : DRIVER_ERR_IO;
@@ -72,13 +103,25 @@ static linux_ctx_t ctx = {
     .path = "/dev/loop0"   // change if your loopback differs
 };
 
+void linux_driver_set_path(const char *path) {
+    ctx.path = path;
+}
+
+void linux_driver_instance(driver_t *d, linux_ctx_t *c, const char *path) {
+    *d = linux_driver;
+    *c = (linux_ctx_t){ .fd = -1, .path = path };
+    d->ctx = c;
+}
+
 driver_t linux_driver = {
     .name = "linux",
-    .sector_size = 512,
+    .sector_size = SECTOR_SIZE,
     .ctx = &ctx,
     .init = linux_init,
     .read_block = linux_read,
     .write_block = linux_write,
+    .read_blocks = linux_read_blocks,
+    .write_blocks = linux_write_blocks,
     .sync = linux_sync,
     .deinit = linux_deinit
 };
@@ -0,0 +1,40 @@
+#ifndef LINUX_DRIVER_H
+#define LINUX_DRIVER_H
+
+#include <stdint.h>
+#include "driver.h"
+
+typedef struct {
+    int fd;
+    const char *path;
+} linux_ctx_t;
+
+/* Blocking pread/pwrite; durability through sync() */
+extern driver_t linux_driver;
+
+/* Device or image path, takes effect on the next init (default /dev/loop0) */
+void linux_driver_set_path(const char *path);
+
+/* A further device in d over its own ctx, e.g. a member of multi_driver */
+void linux_driver_instance(driver_t *d, linux_ctx_t *ctx, const char *path);
+
+/*
+ * io_uring variant: batches (e.g. all mirror copies of a span) are submitted
+ * together and reaped together, with an fsync ordered after them only when
+ * the caller asks for DRIVER_BATCH_SYNC. Works on regular files and loop
+ * devices; no liburing needed.
+ */
+extern driver_t uring_driver;
+
+/* Submission queue depth, takes effect on the next init (default 32) */
+void uring_driver_set_queue_depth(uint32_t depth);
+void uring_driver_set_path(const char *path);
+
+/*
+ * Regular image file mapped with mmap; runs unprivileged. If create_bytes
+ * is non-zero the file is created or grown to that size on init.
+ */
+extern driver_t mmap_driver;
+void mmap_driver_configure(const char *path, uint64_t create_bytes);
+
+#endif /* LINUX_DRIVER_H */
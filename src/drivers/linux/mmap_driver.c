@@ -0,0 +1,146 @@
+#define _GNU_SOURCE
+#include <unistd.h>
+
+#include "config.h"
+#include "driver.h"
+#include "linux_driver.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+typedef struct {
+    int fd;
+    const char *path;
+    uint64_t create_bytes;
+    uint8_t *map;
+    uint64_t map_len;
+} mmap_ctx_t;
+
+static int mmap_init(driver_t *self) {
+    mmap_ctx_t *ctx = (mmap_ctx_t *)self->ctx;
+    if (!ctx->path) return DRIVER_ERR_PARAM;
+
+    ctx->fd = open(ctx->path, O_RDWR | (ctx->create_bytes ? O_CREAT : 0), 0644);
+    if (ctx->fd < 0) {
+        perror("[mmap_driver] open");
+        return DRIVER_ERR_INIT;
+    }
+
+    struct stat st;
+    if (fstat(ctx->fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "[mmap_driver] %s is not a regular file\n", ctx->path);
+        close(ctx->fd);
+        ctx->fd = -1;
+        return DRIVER_ERR_INIT;
+    }
+
+    // grow (never shrink) to the requested image size
+    uint64_t bytes = (uint64_t)st.st_size;
+    if (ctx->create_bytes > bytes) {
+        if (ftruncate(ctx->fd, (off_t)ctx->create_bytes) != 0) {
+            perror("[mmap_driver] ftruncate");
+            close(ctx->fd);
+            ctx->fd = -1;
+            return DRIVER_ERR_INIT;
+        }
+        bytes = ctx->create_bytes;
+    }
+
+    self->total_sectors = bytes / self->sector_size;
+    self->total_size_bytes = bytes;
+    ctx->map_len = self->total_sectors * self->sector_size;
+    if (ctx->map_len == 0) {
+        fprintf(stderr, "[mmap_driver] %s is empty\n", ctx->path);
+        close(ctx->fd);
+        ctx->fd = -1;
+        return DRIVER_ERR_INIT;
+    }
+
+    ctx->map = mmap(NULL, ctx->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, ctx->fd, 0);
+    if (ctx->map == MAP_FAILED) {
+        perror("[mmap_driver] mmap");
+        ctx->map = NULL;
+        close(ctx->fd);
+        ctx->fd = -1;
+        return DRIVER_ERR_INIT;
+    }
+
+    printf("[mmap_driver] Mapped %s: %.2f MB (%lu sectors)\n", ctx->path,
+           bytes / (1024.0 * 1024.0), (unsigned long)self->total_sectors);
+    return DRIVER_OK;
+}
+
+static int mmap_check(driver_t *self, uint64_t lba, uint32_t count, const void *buf) {
+    if (!buf) return DRIVER_ERR_PARAM;
+    if (!((mmap_ctx_t *)self->ctx)->map) return DRIVER_ERR_INIT;
+    if ((uint64_t)lba + count > self->total_sectors) return DRIVER_ERR_PARAM;
+    return DRIVER_OK;
+}
+
+static int mmap_read_blocks(driver_t *self, uint64_t lba, uint32_t count, uint8_t *buf) {
+    int rc = mmap_check(self, lba, count, buf);
+    if (rc != DRIVER_OK) return rc;
+    mmap_ctx_t *ctx = (mmap_ctx_t *)self->ctx;
+    memcpy(buf, ctx->map + (uint64_t)lba * self->sector_size, (size_t)count * self->sector_size);
+    return DRIVER_OK;
+}
+
+static int mmap_write_blocks(driver_t *self, uint64_t lba, uint32_t count, const uint8_t *buf) {
+    int rc = mmap_check(self, lba, count, buf);
+    if (rc != DRIVER_OK) return rc;
+    mmap_ctx_t *ctx = (mmap_ctx_t *)self->ctx;
+    memcpy(ctx->map + (uint64_t)lba * self->sector_size, buf, (size_t)count * self->sector_size);
+    return DRIVER_OK;
+}
+
+static int mmap_read(driver_t *self, uint64_t lba, uint8_t *buf) {
+    return mmap_read_blocks(self, lba, 1, buf);
+}
+
+static int mmap_write(driver_t *self, uint64_t lba, const uint8_t *buf) {
+    return mmap_write_blocks(self, lba, 1, buf);
+}
+
+static int mmap_sync(driver_t *self) {
+    mmap_ctx_t *ctx = (mmap_ctx_t *)self->ctx;
+    if (!ctx->map) return DRIVER_ERR_INIT;
+    return (msync(ctx->map, ctx->map_len, MS_SYNC) == 0) ? DRIVER_OK : DRIVER_ERR_IO;
+}
+
+static void mmap_deinit(driver_t *self) {
+    mmap_ctx_t *ctx = (mmap_ctx_t *)self->ctx;
+    if (ctx->map) munmap(ctx->map, ctx->map_len);
+    if (ctx->fd >= 0) close(ctx->fd);
+    ctx->map = NULL;
+    ctx->fd = -1;
+    printf("[mmap_driver] Closed image\n");
+}
+
+static mmap_ctx_t ctx = {
+    .fd = -1,
+    .path = NULL,
+    .create_bytes = 0,
+    .map = NULL,
+    .map_len = 0
+};
+
+void mmap_driver_configure(const char *path, uint64_t create_bytes) {
+    ctx.path = path;
+    ctx.create_bytes = create_bytes;
+}
+
+driver_t mmap_driver = {
+    .name = "mmap",
+    .sector_size = SECTOR_SIZE,
+    .ctx = &ctx,
+    .init = mmap_init,
+    .read_block = mmap_read,
+    .write_block = mmap_write,
+    .read_blocks = mmap_read_blocks,
+    .write_blocks = mmap_write_blocks,
+    .sync = mmap_sync,
+    .deinit = mmap_deinit
+};
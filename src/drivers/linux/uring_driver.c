@@ -0,0 +1,326 @@
+#define _GNU_SOURCE
+#include <unistd.h>
+
+#include "config.h"
+#include "driver.h"
+#include "linux_driver.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#include <linux/io_uring.h>
+
+#define URING_DEFAULT_DEPTH 32
+
+typedef struct {
+    /* submission ring */
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    struct io_uring_sqe *sqes;
+    /* completion ring */
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ptr, *cq_ptr;
+    size_t sq_len, cq_len, sqes_len;
+    unsigned entries;
+    int ring_fd;
+} uring_t;
+
+typedef struct {
+    int fd;
+    const char *path;
+    uint32_t depth;
+    uring_t ring;
+} uring_ctx_t;
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                              unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                        NULL, 0);
+}
+
+static void uring_unmap(uring_t *r) {
+    if (r->sqes && r->sqes != MAP_FAILED) munmap(r->sqes, r->sqes_len);
+    if (r->cq_ptr && r->cq_ptr != MAP_FAILED && r->cq_ptr != r->sq_ptr)
+        munmap(r->cq_ptr, r->cq_len);
+    if (r->sq_ptr && r->sq_ptr != MAP_FAILED) munmap(r->sq_ptr, r->sq_len);
+    if (r->ring_fd >= 0) close(r->ring_fd);
+    memset(r, 0, sizeof(*r));
+    r->ring_fd = -1;
+}
+
+static int uring_setup(uring_t *r, unsigned depth) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(r, 0, sizeof(*r));
+
+    r->ring_fd = sys_io_uring_setup(depth, &p);
+    if (r->ring_fd < 0) {
+        perror("[uring_driver] io_uring_setup");
+        return DRIVER_ERR_INIT;
+    }
+
+    r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_len > r->sq_len) r->sq_len = r->cq_len;
+        r->cq_len = r->sq_len;
+    }
+
+    r->sq_ptr = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_SQ_RING);
+    if (r->sq_ptr == MAP_FAILED) goto fail;
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ptr = r->sq_ptr;
+    } else {
+        r->cq_ptr = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_CQ_RING);
+        if (r->cq_ptr == MAP_FAILED) goto fail;
+    }
+
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) goto fail;
+
+    uint8_t *sq = (uint8_t *)r->sq_ptr;
+    uint8_t *cq = (uint8_t *)r->cq_ptr;
+    r->sq_head  = (unsigned *)(void *)(sq + p.sq_off.head);
+    r->sq_tail  = (unsigned *)(void *)(sq + p.sq_off.tail);
+    r->sq_mask  = (unsigned *)(void *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(void *)(sq + p.sq_off.array);
+    r->cq_head  = (unsigned *)(void *)(cq + p.cq_off.head);
+    r->cq_tail  = (unsigned *)(void *)(cq + p.cq_off.tail);
+    r->cq_mask  = (unsigned *)(void *)(cq + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)(void *)(cq + p.cq_off.cqes);
+    r->entries  = p.sq_entries;
+    return DRIVER_OK;
+
+fail:
+    perror("[uring_driver] mmap");
+    uring_unmap(r);
+    return DRIVER_ERR_INIT;
+}
+
+/* Queue one SQE; the caller never queues more than ring->entries at once */
+static struct io_uring_sqe *uring_get_sqe(uring_t *r) {
+    unsigned tail = *r->sq_tail;
+    unsigned idx = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sq_array[idx] = idx;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+/* Reap the CQEs that are in; each is checked against expect[user_data] */
+static unsigned uring_reap(uring_t *r, const uint32_t *expect, int *status) {
+    unsigned head = *r->cq_head, reaped = 0;
+    unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+        if (cqe->res < 0 || (uint32_t)cqe->res != expect[cqe->user_data])
+            *status = DRIVER_ERR_IO;
+        head++;
+        reaped++;
+    }
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    return reaped;
+}
+
+/*
+ * Submit everything queued and wait for all of it. If io_uring_enter
+ * fails, the SQEs the kernel has not taken are dropped and the ones it
+ * has are waited for, so no completion is left for the next batch and no
+ * write still points at the caller's buffers. If even that wait fails
+ * the ring is torn down (DRIVER_ERR_INIT until the next init).
+ */
+static int uring_submit_wait(uring_t *r, unsigned n, const uint32_t *expect) {
+    int status = DRIVER_OK;
+    unsigned submitted = 0, reaped = 0;
+
+    while (reaped < n) {
+        unsigned to_submit = n - submitted;
+        int rc = sys_io_uring_enter(r->ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            perror("[uring_driver] io_uring_enter");
+            status = DRIVER_ERR_IO;
+            break;
+        }
+        submitted += (unsigned)rc;
+        reaped += uring_reap(r, expect, &status);
+    }
+    if (reaped == n) return status;
+
+    /* no SQPOLL: whatever is past the kernel's head was never seen by it */
+    __atomic_store_n(r->sq_tail, __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    while (reaped < submitted) {
+        if (sys_io_uring_enter(r->ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            perror("[uring_driver] io_uring_enter (drain)");
+            uring_unmap(r);
+            return DRIVER_ERR_IO;
+        }
+        reaped += uring_reap(r, expect, &status);
+    }
+    return status;
+}
+
+static int uring_init(driver_t *self) {
+    uring_ctx_t *ctx = (uring_ctx_t *)self->ctx;
+
+    /* no O_SYNC: durability comes from the fsync queued behind a batch */
+    ctx->fd = open(ctx->path, O_RDWR);
+    if (ctx->fd < 0) {
+        perror("[uring_driver] open");
+        return DRIVER_ERR_INIT;
+    }
+
+    uint64_t bytes = 0;
+    struct stat st;
+    if (ioctl(ctx->fd, BLKGETSIZE64, &bytes) == -1) {
+        if (fstat(ctx->fd, &st) == 0 && S_ISREG(st.st_mode)) bytes = (uint64_t)st.st_size;
+        else perror("[uring_driver] ioctl(BLKGETSIZE64)");
+    }
+    self->total_size_bytes = bytes;
+    self->total_sectors = bytes / self->sector_size;
+
+    int rc = uring_setup(&ctx->ring, ctx->depth ? ctx->depth : URING_DEFAULT_DEPTH);
+    if (rc != DRIVER_OK) {
+        close(ctx->fd);
+        ctx->fd = -1;
+        return rc;
+    }
+
+    printf("[uring_driver] Opened %s: %.2f MB (%lu sectors), queue depth %u\n",
+           ctx->path, bytes / (1024.0 * 1024.0),
+           (unsigned long)self->total_sectors, ctx->ring.entries);
+    return DRIVER_OK;
+}
+
+static int uring_read(driver_t *self, uint64_t lba, uint8_t *buf) {
+    uring_ctx_t *ctx = (uring_ctx_t *)self->ctx;
+    if (!buf) return DRIVER_ERR_PARAM;
+    ssize_t rc = pread(ctx->fd, buf, self->sector_size, (off_t)lba * self->sector_size);
+    return (rc == (ssize_t)self->sector_size) ? DRIVER_OK : DRIVER_ERR_IO;
+}
+
+static int uring_read_blocks(driver_t *self, uint64_t lba, uint32_t count, uint8_t *buf) {
+    uring_ctx_t *ctx = (uring_ctx_t *)self->ctx;
+    if (!buf) return DRIVER_ERR_PARAM;
+    size_t len = (size_t)count * self->sector_size;
+    ssize_t rc = pread(ctx->fd, buf, len, (off_t)lba * self->sector_size);
+    return (rc == (ssize_t)len) ? DRIVER_OK : DRIVER_ERR_IO;
+}
+
+static int uring_write_batch(driver_t *self, const driver_write_t *reqs,
+                             uint32_t nreqs, uint32_t flags) {
+    uring_ctx_t *ctx = (uring_ctx_t *)self->ctx;
+    uring_t *r = &ctx->ring;
+    uint32_t expect[URING_DEFAULT_DEPTH * 8];
+    unsigned cap = r->entries;
+    if (cap > sizeof(expect) / sizeof(expect[0])) cap = sizeof(expect) / sizeof(expect[0]);
+
+    if (!reqs && nreqs) return DRIVER_ERR_PARAM;
+    if (r->ring_fd < 0) return DRIVER_ERR_INIT;
+
+    uint32_t done = 0;
+    int want_sync = (flags & DRIVER_BATCH_SYNC) != 0;
+    int status = DRIVER_OK;
+
+    /* one round per ring-full; the fsync rides in the last round */
+    while (done < nreqs || want_sync) {
+        unsigned n = 0;
+        while (done < nreqs && n < cap) {
+            const driver_write_t *w = &reqs[done];
+            struct io_uring_sqe *sqe = uring_get_sqe(r);
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = ctx->fd;
+            sqe->addr = (uint64_t)(uintptr_t)w->buffer;
+            sqe->len = w->count * self->sector_size;
+            sqe->off = (uint64_t)w->lba * self->sector_size;
+            sqe->user_data = n;
+            expect[n++] = sqe->len;
+            done++;
+        }
+        if (want_sync && done == nreqs && n < cap) {
+            /* drain: starts only after every write queued before it completed */
+            struct io_uring_sqe *sqe = uring_get_sqe(r);
+            sqe->opcode = IORING_OP_FSYNC;
+            sqe->fd = ctx->fd;
+            sqe->flags = IOSQE_IO_DRAIN;
+            sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+            sqe->user_data = n;
+            expect[n++] = 0;
+            want_sync = 0;
+        }
+
+        int rc = uring_submit_wait(r, n, expect);
+        if (rc != DRIVER_OK) status = rc;
+        if (r->ring_fd < 0) break;   // torn down, see uring_submit_wait()
+    }
+    return status;
+}
+
+static int uring_write(driver_t *self, uint64_t lba, const uint8_t *buf) {
+    if (!buf) return DRIVER_ERR_PARAM;
+    driver_write_t w = { .lba = lba, .count = 1, .buffer = buf };
+    return uring_write_batch(self, &w, 1, 0);
+}
+
+static int uring_write_blocks(driver_t *self, uint64_t lba, uint32_t count, const uint8_t *buf) {
+    if (!buf) return DRIVER_ERR_PARAM;
+    driver_write_t w = { .lba = lba, .count = count, .buffer = buf };
+    return uring_write_batch(self, &w, 1, 0);
+}
+
+static int uring_sync(driver_t *self) {
+    return uring_write_batch(self, NULL, 0, DRIVER_BATCH_SYNC);
+}
+
+static void uring_deinit(driver_t *self) {
+    uring_ctx_t *ctx = (uring_ctx_t *)self->ctx;
+    uring_unmap(&ctx->ring);
+    if (ctx->fd >= 0) close(ctx->fd);
+    ctx->fd = -1;
+    printf("[uring_driver] Closed device\n");
+}
+
+static uring_ctx_t ctx = {
+    .fd = -1,
+    .path = "/dev/loop0",   // change if your loopback differs
+    .depth = URING_DEFAULT_DEPTH,
+    .ring = { .ring_fd = -1 }
+};
+
+void uring_driver_set_queue_depth(uint32_t depth) {
+    ctx.depth = depth;
+}
+
+void uring_driver_set_path(const char *path) {
+    ctx.path = path;
+}
+
+driver_t uring_driver = {
+    .name = "uring",
+    .sector_size = SECTOR_SIZE,
+    .ctx = &ctx,
+    .init = uring_init,
+    .read_block = uring_read,
+    .write_block = uring_write,
+    .read_blocks = uring_read_blocks,
+    .write_blocks = uring_write_blocks,
+    .write_batch = uring_write_batch,
+    .sync = uring_sync,
+    .deinit = uring_deinit
+};
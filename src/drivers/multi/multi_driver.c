@@ -0,0 +1,309 @@
+#include "config.h"
+#include "multi_driver.h"
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MULTI_HAVE_THREADS 1
+#include <pthread.h>
+#else
+#define MULTI_HAVE_THREADS 0
+#endif
+
+typedef struct {
+    driver_t *dev;
+    driver_write_t queue[MULTI_QUEUE_MAX];   // this round's writes, in member LBAs
+    uint32_t queued;
+    uint32_t flags;
+    int rc;
+#if MULTI_HAVE_THREADS
+    pthread_t tid;
+    uint32_t gen;    // bumped by the caller for every job
+    uint8_t stop;
+#endif
+} member_t;
+
+typedef struct {
+    member_t m[MULTI_DEVICES_MAX];
+    uint8_t n;
+    uint8_t slices;
+    uint8_t threads;           // workers running
+    uint64_t slice_len;
+#if MULTI_HAVE_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t work, done;
+    uint32_t pending;
+#endif
+} multi_ctx_t;
+
+/* Member and member LBA of a virtual LBA; room is what is left of its slice */
+static member_t *locate(multi_ctx_t *ctx, uint64_t lba, uint64_t *mlba, uint64_t *room) {
+    uint64_t s = lba / ctx->slice_len, off = lba % ctx->slice_len;
+    *mlba = (s / ctx->n) * ctx->slice_len + off;
+    *room = ctx->slice_len - off;
+    return &ctx->m[s % ctx->n];
+}
+
+static int member_io(driver_t *d, uint64_t lba, uint32_t count, uint8_t *buf, int write) {
+    if (write && d->write_blocks) return d->write_blocks(d, lba, count, buf);
+    if (!write && d->read_blocks) return d->read_blocks(d, lba, count, buf);
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t *p = buf + (size_t)i * d->sector_size;
+        int rc = write ? d->write_block(d, lba + i, p) : d->read_block(d, lba + i, p);
+        if (rc != DRIVER_OK) return rc;
+    }
+    return DRIVER_OK;
+}
+
+/* One member's share of a round: its queued writes, then a sync if asked */
+static int member_run(member_t *m) {
+    driver_t *d = m->dev;
+    uint32_t flags = m->flags;
+    int rc = DRIVER_OK;
+
+    if (m->queued && d->write_batch) {
+        rc = d->write_batch(d, m->queue, m->queued, flags);
+        flags &= ~DRIVER_BATCH_SYNC;
+    } else {
+        for (uint32_t i = 0; i < m->queued && rc == DRIVER_OK; i++)
+            rc = member_io(d, m->queue[i].lba, m->queue[i].count, (uint8_t *)m->queue[i].buffer, 1);
+    }
+    if (rc == DRIVER_OK && (flags & DRIVER_BATCH_SYNC) && d->sync) rc = d->sync(d);
+    m->queued = 0;
+    return rc;
+}
+
+static multi_ctx_t ctx;
+
+#if MULTI_HAVE_THREADS
+static void *member_thread(void *arg) {
+    member_t *m = arg;
+    uint32_t seen = 0;
+
+    pthread_mutex_lock(&ctx.lock);
+    for (;;) {
+        while (m->gen == seen) pthread_cond_wait(&ctx.work, &ctx.lock);
+        seen = m->gen;
+        if (m->stop) break;
+        pthread_mutex_unlock(&ctx.lock);
+        int rc = member_run(m);
+        pthread_mutex_lock(&ctx.lock);
+        m->rc = rc;
+        if (--ctx.pending == 0) pthread_cond_signal(&ctx.done);
+    }
+    pthread_mutex_unlock(&ctx.lock);
+    return NULL;
+}
+
+static void stop_threads(multi_ctx_t *c) {
+    pthread_mutex_lock(&c->lock);
+    for (uint8_t i = 0; i < c->threads; i++) {
+        c->m[i].stop = 1;
+        c->m[i].gen++;
+    }
+    pthread_cond_broadcast(&c->work);
+    pthread_mutex_unlock(&c->lock);
+    for (uint8_t i = 0; i < c->threads; i++) pthread_join(c->m[i].tid, NULL);
+    pthread_cond_destroy(&c->done);
+    pthread_cond_destroy(&c->work);
+    pthread_mutex_destroy(&c->lock);
+    c->threads = 0;
+}
+#endif
+
+/*
+ * Run every member with queued writes (all of them for a sync) and wait.
+ * A lone member is run on the calling thread, the handoff would only add
+ * latency.
+ */
+static int run_round(multi_ctx_t *c, uint32_t flags) {
+    uint8_t active = 0;
+    int rc = DRIVER_OK;
+
+    for (uint8_t i = 0; i < c->n; i++) {
+        member_t *m = &c->m[i];
+        m->flags = flags;
+        m->rc = DRIVER_OK;
+        if (m->queued || (flags & DRIVER_BATCH_SYNC)) active++;
+    }
+    if (active == 1 || (active && !c->threads)) {
+        for (uint8_t i = 0; i < c->n; i++)
+            if (c->m[i].queued || (flags & DRIVER_BATCH_SYNC)) c->m[i].rc = member_run(&c->m[i]);
+    }
+#if MULTI_HAVE_THREADS
+    else if (active) {
+        pthread_mutex_lock(&c->lock);
+        for (uint8_t i = 0; i < c->n; i++) {
+            if (c->m[i].queued || (flags & DRIVER_BATCH_SYNC)) {
+                c->m[i].gen++;
+                c->pending++;
+            }
+        }
+        pthread_cond_broadcast(&c->work);
+        while (c->pending) pthread_cond_wait(&c->done, &c->lock);
+        pthread_mutex_unlock(&c->lock);
+    }
+#endif
+    for (uint8_t i = 0; i < c->n; i++)
+        if (c->m[i].rc != DRIVER_OK && rc == DRIVER_OK) rc = c->m[i].rc;
+    return rc;
+}
+
+static void multi_deinit(driver_t *self) {
+    multi_ctx_t *c = (multi_ctx_t *)self->ctx;
+#if MULTI_HAVE_THREADS
+    if (c->threads) stop_threads(c);
+#endif
+    for (uint8_t i = 0; i < c->n; i++) c->m[i].dev->deinit(c->m[i].dev);
+    c->slice_len = 0;
+}
+
+static int multi_init(driver_t *self) {
+    multi_ctx_t *c = (multi_ctx_t *)self->ctx;
+    uint8_t ready = 0;
+    int rc = DRIVER_OK;
+
+    if (c->n == 0) return DRIVER_ERR_PARAM;
+    if (c->slice_len) multi_deinit(self);   // running: join the workers before starting over
+    uint64_t per = (c->slices + c->n - 1) / c->n;   // slices on the busiest member
+    c->slice_len = UINT64_MAX;
+    for (; ready < c->n; ready++) {
+        driver_t *d = c->m[ready].dev;
+        c->m[ready].queued = 0;
+        if (d->sector_size != self->sector_size) {
+            fprintf(stderr, "[multi_driver] %s: sector size %u, expected %u\n", d->name,
+                    d->sector_size, self->sector_size);
+            rc = DRIVER_ERR_PARAM;
+            break;
+        }
+        rc = d->init(d);
+        if (rc != DRIVER_OK) break;
+        if (d->total_sectors / per < c->slice_len) c->slice_len = d->total_sectors / per;
+    }
+    if (rc == DRIVER_OK && c->slice_len == 0) rc = DRIVER_ERR_INIT;
+
+#if MULTI_HAVE_THREADS
+    if (rc == DRIVER_OK && c->n > 1) {
+        pthread_mutex_init(&c->lock, NULL);
+        pthread_cond_init(&c->work, NULL);
+        pthread_cond_init(&c->done, NULL);
+        c->pending = 0;
+        for (; c->threads < c->n; c->threads++) {
+            member_t *m = &c->m[c->threads];
+            m->gen = 0;
+            m->stop = 0;
+            if (pthread_create(&m->tid, NULL, member_thread, m) != 0) break;
+        }
+        if (c->threads < c->n) {
+            stop_threads(c);
+            rc = DRIVER_ERR_INIT;
+        }
+    }
+#endif
+    if (rc != DRIVER_OK) {
+        for (uint8_t i = 0; i < ready; i++) c->m[i].dev->deinit(c->m[i].dev);
+        c->slice_len = 0;
+        return rc;
+    }
+
+    self->total_sectors = c->slice_len * c->slices;
+    self->total_size_bytes = self->total_sectors * self->sector_size;
+    printf("[multi_driver] %u devices, %u slices of %lu sectors\n", c->n, c->slices,
+           (unsigned long)c->slice_len);
+    return DRIVER_OK;
+}
+
+static int multi_io(driver_t *self, uint64_t lba, uint32_t count, uint8_t *buf, int write) {
+    multi_ctx_t *c = (multi_ctx_t *)self->ctx;
+    if (!buf) return DRIVER_ERR_PARAM;
+    if (c->slice_len == 0) return DRIVER_ERR_INIT;
+    if (lba + count > self->total_sectors) return DRIVER_ERR_PARAM;
+
+    while (count) {
+        uint64_t mlba, room;
+        member_t *m = locate(c, lba, &mlba, &room);
+        uint32_t n = (room < count) ? (uint32_t)room : count;
+        int rc = member_io(m->dev, mlba, n, buf, write);
+        if (rc != DRIVER_OK) return rc;
+        lba += n;
+        count -= n;
+        buf += (size_t)n * self->sector_size;
+    }
+    return DRIVER_OK;
+}
+
+static int multi_read_blocks(driver_t *self, uint64_t lba, uint32_t count, uint8_t *buf) {
+    return multi_io(self, lba, count, buf, 0);
+}
+
+static int multi_write_blocks(driver_t *self, uint64_t lba, uint32_t count, const uint8_t *buf) {
+    return multi_io(self, lba, count, (uint8_t *)buf, 1);
+}
+
+static int multi_read(driver_t *self, uint64_t lba, uint8_t *buf) {
+    return multi_io(self, lba, 1, buf, 0);
+}
+
+static int multi_write(driver_t *self, uint64_t lba, const uint8_t *buf) {
+    return multi_io(self, lba, 1, (uint8_t *)buf, 1);
+}
+
+/* Deal the writes out to their members, then run them all at once. All
+ * requests are checked first: nothing of a rejected batch stays queued. */
+static int multi_write_batch(driver_t *self, const driver_write_t *reqs, uint32_t nreqs, uint32_t flags) {
+    multi_ctx_t *c = (multi_ctx_t *)self->ctx;
+    if (!reqs) return DRIVER_ERR_PARAM;
+    if (c->slice_len == 0) return DRIVER_ERR_INIT;
+    for (uint32_t r = 0; r < nreqs; r++)
+        if (!reqs[r].buffer || reqs[r].lba + reqs[r].count > self->total_sectors) return DRIVER_ERR_PARAM;
+
+    for (uint32_t r = 0; r < nreqs; r++) {
+        uint64_t lba = reqs[r].lba;
+        uint32_t count = reqs[r].count;
+        const uint8_t *buf = reqs[r].buffer;
+
+        while (count) {
+            uint64_t mlba, room;
+            member_t *m = locate(c, lba, &mlba, &room);
+            uint32_t n = (room < count) ? (uint32_t)room : count;
+            if (m->queued == MULTI_QUEUE_MAX) {
+                int rc = run_round(c, 0);   // clears every queue, failed or not
+                if (rc != DRIVER_OK) return rc;
+            }
+            m->queue[m->queued++] = (driver_write_t){ mlba, n, buf };
+            lba += n;
+            count -= n;
+            buf += (size_t)n * self->sector_size;
+        }
+    }
+    return run_round(c, flags);
+}
+
+static int multi_sync(driver_t *self) {
+    return run_round((multi_ctx_t *)self->ctx, DRIVER_BATCH_SYNC);
+}
+
+int multi_driver_configure(driver_t *const *members, uint8_t n, uint8_t slices) {
+    if (!members || n == 0 || n > MULTI_DEVICES_MAX) return DRIVER_ERR_PARAM;
+    if (ctx.slice_len) return DRIVER_ERR_INIT;   // deinit first
+    for (uint8_t i = 0; i < n; i++) {
+        if (!members[i]) return DRIVER_ERR_PARAM;
+        ctx.m[i].dev = members[i];
+    }
+    ctx.n = n;
+    ctx.slices = slices ? slices : RAID_MIRRORS;
+    return DRIVER_OK;
+}
+
+driver_t multi_driver = {
+    .name = "multi",
+    .sector_size = SECTOR_SIZE,
+    .ctx = &ctx,
+    .init = multi_init,
+    .read_block = multi_read,
+    .write_block = multi_write,
+    .read_blocks = multi_read_blocks,
+    .write_blocks = multi_write_blocks,
+    .write_batch = multi_write_batch,
+    .sync = multi_sync,
+    .deinit = multi_deinit
+};
@@ -0,0 +1,34 @@
+#ifndef MULTI_DRIVER_H
+#define MULTI_DRIVER_H
+
+#include <stdint.h>
+#include "driver.h"
+
+#define MULTI_DEVICES_MAX 4
+#define MULTI_QUEUE_MAX 32   ///< Writes queued per device before a batch is split into rounds
+
+/*
+ * One logical card over several block devices. The card's slices (the
+ * RAID_MIRRORS copies, or the k + m columns of a parity layout) are dealt
+ * round-robin: slice s lives on device s % n, so copies and columns land
+ * on different devices and a lost device costs at most ceil(slices / n)
+ * of them. Every device gets a worker thread; the writes of a batch and
+ * a sync() run on all devices at once. Without pthreads the devices are
+ * serviced in turn. With one slice per device and equal sizes, the
+ * devices concatenated in order are the single image the reader takes.
+ *
+ * Reads survive a lost device through the storage layer's other copies,
+ * writes do not: an error on any member fails the whole write or batch,
+ * so appends stop until the device is replaced (no degraded mode).
+ */
+extern driver_t multi_driver;
+
+/*
+ * Takes effect on the next init, which also inits the members (all with
+ * the same sector_size). slices must match the layout the card is, or
+ * will be, formatted with; 0 means RAID_MIRRORS. DRIVER_ERR_INIT while
+ * the driver is initialized; init again restarts it with the same members.
+ */
+int multi_driver_configure(driver_t *const *members, uint8_t n, uint8_t slices);
+
+#endif /* MULTI_DRIVER_H */
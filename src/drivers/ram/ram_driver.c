@@ -0,0 +1,100 @@
+#include "config.h"
+#include "ram_driver.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RAM_DEFAULT_SIZE (5u * 1024u * 1024u)   // same as tools/loopback_device.md
+
+static int ram_check(driver_t *self, uint64_t lba, uint32_t count, const void *buf) {
+    if (!buf) return DRIVER_ERR_PARAM;
+    if (!((ram_ctx_t *)self->ctx)->data) return DRIVER_ERR_INIT;
+    if ((uint64_t)lba + count > self->total_sectors) return DRIVER_ERR_PARAM;
+    return DRIVER_OK;
+}
+
+static int ram_init(driver_t *self) {
+    ram_ctx_t *ctx = (ram_ctx_t *)self->ctx;
+
+    if (ctx->user_buffer) {
+        ctx->data = ctx->user_buffer;
+        ctx->owned = 0;
+    } else {
+        ctx->data = calloc(1, (size_t)ctx->size);
+        if (!ctx->data) return DRIVER_ERR_INIT;
+        ctx->owned = 1;
+    }
+
+    self->total_size_bytes = ctx->size;
+    self->total_sectors = ctx->size / self->sector_size;
+    printf("[ram_driver] %.2f MB (%lu sectors)\n",
+           ctx->size / (1024.0 * 1024.0), (unsigned long)self->total_sectors);
+    return DRIVER_OK;
+}
+
+static int ram_read_blocks(driver_t *self, uint64_t lba, uint32_t count, uint8_t *buf) {
+    int rc = ram_check(self, lba, count, buf);
+    if (rc != DRIVER_OK) return rc;
+    ram_ctx_t *ctx = (ram_ctx_t *)self->ctx;
+    memcpy(buf, ctx->data + (uint64_t)lba * self->sector_size, (size_t)count * self->sector_size);
+    return DRIVER_OK;
+}
+
+static int ram_write_blocks(driver_t *self, uint64_t lba, uint32_t count, const uint8_t *buf) {
+    int rc = ram_check(self, lba, count, buf);
+    if (rc != DRIVER_OK) return rc;
+    ram_ctx_t *ctx = (ram_ctx_t *)self->ctx;
+    memcpy(ctx->data + (uint64_t)lba * self->sector_size, buf, (size_t)count * self->sector_size);
+    return DRIVER_OK;
+}
+
+static int ram_read(driver_t *self, uint64_t lba, uint8_t *buf) {
+    return ram_read_blocks(self, lba, 1, buf);
+}
+
+static int ram_write(driver_t *self, uint64_t lba, const uint8_t *buf) {
+    return ram_write_blocks(self, lba, 1, buf);
+}
+
+static int ram_sync(driver_t *self) {
+    (void)self;
+    return DRIVER_OK;
+}
+
+static void ram_deinit(driver_t *self) {
+    ram_ctx_t *ctx = (ram_ctx_t *)self->ctx;
+    if (ctx->owned) free(ctx->data);
+    ctx->data = NULL;
+    ctx->owned = 0;
+}
+
+static ram_ctx_t ctx = {
+    .data = NULL,
+    .size = RAM_DEFAULT_SIZE,
+    .user_buffer = NULL,
+    .owned = 0
+};
+
+void ram_driver_configure(void *buffer, uint64_t size_bytes) {
+    ctx.user_buffer = (uint8_t *)buffer;
+    ctx.size = size_bytes;
+}
+
+void ram_driver_instance(driver_t *d, ram_ctx_t *c, void *buffer, uint64_t size_bytes) {
+    *d = ram_driver;
+    *c = (ram_ctx_t){ .size = size_bytes, .user_buffer = (uint8_t *)buffer };
+    d->ctx = c;
+}
+
+driver_t ram_driver = {
+    .name = "ram",
+    .sector_size = SECTOR_SIZE,
+    .ctx = &ctx,
+    .init = ram_init,
+    .read_block = ram_read,
+    .write_block = ram_write,
+    .read_blocks = ram_read_blocks,
+    .write_blocks = ram_write_blocks,
+    .sync = ram_sync,
+    .deinit = ram_deinit
+};
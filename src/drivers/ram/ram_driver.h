@@ -0,0 +1,27 @@
+#ifndef RAM_DRIVER_H
+#define RAM_DRIVER_H
+
+#include <stdint.h>
+#include "driver.h"
+
+typedef struct {
+    uint8_t *data;
+    uint64_t size;
+    uint8_t *user_buffer;
+    uint8_t owned;
+} ram_ctx_t;
+
+/* RAM disk, for host tests and benchmarks (no device, no privileges) */
+extern driver_t ram_driver;
+
+/*
+ * Takes effect on the next init. buffer == NULL allocates size_bytes
+ * (zeroed) at init and frees it at deinit; otherwise the caller's buffer
+ * is used as-is, e.g. a static array on a target without malloc.
+ */
+void ram_driver_configure(void *buffer, uint64_t size_bytes);
+
+/* A further RAM disk in d over its own ctx, e.g. a member of multi_driver */
+void ram_driver_instance(driver_t *d, ram_ctx_t *ctx, void *buffer, uint64_t size_bytes);
+
+#endif /* RAM_DRIVER_H */
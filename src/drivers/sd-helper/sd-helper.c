@@ -38,20 +38,69 @@ static uint8_t sd_spi_send(spi_t* bus, uint8_t v) {
   return (rc == 0x00) ? SD_OK : SD_ERR_SPI;
 }
 
-static uint8_t sd_spi_send_bytes(spi_t* bus, const uint8_t *p, uint32_t n){
+/* ==== Block transfers: DMA when installed, byte loop otherwise ==== */
+
+/* Transfers shorter than this (command frames, R7/OCR) stay polled */
+#define SD_DMA_MIN_BYTES 64u
+/* Upper bound on completion polls before the DMA is declared stuck */
+#define SD_DMA_SPIN_LIMIT 0x100000u
+
+static const sd_dma_ops_t *g_dma = NULL;
+static uint8_t g_xfer_on_dma = 0;
+
+void sd_set_dma(const sd_dma_ops_t *ops){ g_dma = ops; }
+
+/* tx == NULL clocks out 0xFF, rx == NULL discards what comes back */
+static uint8_t sd_spi_xfer_polled(spi_t* bus, const uint8_t *tx, uint8_t *rx, uint32_t n){
+  uint8_t in;
   while (n--) {
-    uint8_t rc = sd_spi_send(bus, *p++);
-    if (rc) return rc;
+    uint8_t rc = spi_txrx(bus, tx ? *tx++ : 0xFF, rx ? rx++ : &in);
+    if (rc) return SD_ERR_SPI;
   }
   return SD_OK;
 }
 
-static uint8_t sd_spi_recv_bytes(spi_t* bus, uint8_t *p, uint32_t n){
-  while (n--) {
-    uint8_t rc = sd_spi_recv(bus, p++);
-    if (rc) return rc;
+uint8_t sd_spi_xfer_start(spi_t* bus, const uint8_t *tx, uint8_t *rx, uint32_t n){
+  if (g_xfer_on_dma) return SD_ERR_PARAM; // previous transfer not completed
+  if (g_dma && n >= SD_DMA_MIN_BYTES) {
+    if (g_dma->start(bus, tx, rx, n)) return SD_ERR_SPI;
+    g_xfer_on_dma = 1;
+    return SD_OK;
   }
-  return SD_OK;
+  // polled fallback is already complete when it returns
+  return sd_spi_xfer_polled(bus, tx, rx, n);
+}
+
+uint8_t sd_spi_xfer_complete(spi_t* bus, uint8_t wait){
+  if (!g_xfer_on_dma) return SD_OK;
+
+  uint32_t spins = SD_DMA_SPIN_LIMIT;
+  do {
+    uint8_t status = SD_OK;
+    if (g_dma->poll(bus, &status)) {
+      g_xfer_on_dma = 0;
+      return status ? SD_ERR_SPI : SD_OK;
+    }
+  } while (wait && --spins);
+
+  if (!wait) return SD_XFER_PENDING;
+  g_dma->abort(bus);
+  g_xfer_on_dma = 0;
+  return SD_ERR_TIMEOUT;
+}
+
+static uint8_t sd_spi_xfer(spi_t* bus, const uint8_t *tx, uint8_t *rx, uint32_t n){
+  uint8_t rc = sd_spi_xfer_start(bus, tx, rx, n);
+  if (rc) return rc;
+  return sd_spi_xfer_complete(bus, 1);
+}
+
+static uint8_t sd_spi_send_bytes(spi_t* bus, const uint8_t *p, uint32_t n){
+  return sd_spi_xfer(bus, p, NULL, n);
+}
+
+static uint8_t sd_spi_recv_bytes(spi_t* bus, uint8_t *p, uint32_t n){
+  return sd_spi_xfer(bus, NULL, p, n);
 }
 
 /* >= 74 clocks with CS high */
@@ -107,6 +156,18 @@ static uint8_t sd_cmd_r1(spi_t* bus, uint8_t cmd, uint32_t arg, uint8_t crc, uin
   return rc; // caller will release CS
 }
 
+/* Card holds MISO low while programming; 0xFF means ready */
+static uint8_t sd_wait_not_busy(spi_t* bus, uint32_t ms){
+  while (ms--) {
+    uint8_t b = 0x00;
+    uint8_t rc = sd_spi_recv(bus, &b);
+    if (rc) return rc;
+    if (b == 0xFF) return SD_OK;
+    delay_ms(1);
+  }
+  return SD_ERR_TIMEOUT;
+}
+
 static uint8_t sd_cs_release(spi_t* bus){
   uint8_t rc = SD_CS_HIGH(bus);
   if (rc) return rc;
@@ -274,15 +335,160 @@ uint8_t sd_write_block(spi_t* bus, uint32_t lba, const uint8_t *src512){
   if ((resp & 0x1F) != 0x05){ sd_cs_release(bus); return SD_ERR_RESP; }
 
   // Wait not busy (card drives MISO low while programming)
-  uint32_t t = bus->token_timeout;
-  while (t--) {
-    uint8_t b = 0x00;
-    rc = sd_spi_recv(bus, &b);
-    if (rc) { sd_cs_release(bus); return rc; }
-    if (b == 0xFF) break;
-    delay_ms(1);
-  }
-  if ((int32_t)t <= 0) { sd_cs_release(bus); return SD_ERR_TIMEOUT; }
+  rc = sd_wait_not_busy(bus, bus->token_timeout);
+  if (rc) { sd_cs_release(bus); return rc; }
 
   return sd_cs_release(bus);
 }
+
+/* ==== Multi-block transfers ==== */
+
+/* CMD12 inside an open CMD18: CS stays low, the byte after the frame is junk */
+static uint8_t sd_stop_transmission(spi_t* bus){
+  uint8_t frame[6] = { 0x40 | 12, 0, 0, 0, 0, 0xFF };
+  uint8_t rc = sd_spi_send_bytes(bus, frame, 6);
+  if (rc) return rc;
+
+  uint8_t stuff;
+  rc = sd_spi_recv(bus, &stuff);
+  if (rc) return rc;
+
+  uint8_t r1 = 0xFF;
+  rc = sd_wait_r1(bus, &r1, spi_s3.cmd_timeout);
+  if (rc) return rc;
+
+  return sd_wait_not_busy(bus, bus->token_timeout);
+}
+
+/* CMD55 + ACMD23: number of blocks to pre-erase before the next CMD25 */
+static uint8_t sd_set_wr_blk_erase_count(spi_t* bus, uint32_t count){
+  uint8_t r1 = 0xFF, rc, rc2;
+
+  rc = sd_cmd_r1(bus, 55, 0, 0xFF, &r1);
+  rc2 = sd_cs_release(bus);
+  if (rc) return rc;
+  if (rc2) return rc2;
+  if (r1 > 0x01) return SD_ERR_BAD_R1;
+
+  rc = sd_cmd_r1(bus, 23, count & 0x007FFFFFu, 0xFF, &r1);
+  rc2 = sd_cs_release(bus);
+  if (rc) return rc;
+  if (rc2) return rc2;
+  return (r1 == 0x00) ? SD_OK : SD_ERR_BAD_R1;
+}
+
+uint8_t sd_read_blocks(spi_t* bus, uint32_t lba, uint32_t count, uint8_t *dst){
+  if (!dst) return SD_ERR_PARAM;
+  if (count == 0) return SD_OK;
+  if (count == 1) return sd_read_block(bus, lba, dst);
+
+  uint8_t r1 = 0xFF, rc;
+
+  rc = sd_cmd_r1(bus, 18, sd_arg_addr(lba), 0xFF, &r1);
+  if (rc) { sd_cs_release(bus); return rc; }
+  if (r1 != 0x00){ sd_cs_release(bus); return SD_ERR_BAD_R1; }
+
+  // one data token + 512 bytes + 2 CRC per block, no CS toggling in between
+  for (uint32_t i = 0; i < count && !rc; i++, dst += 512) {
+    rc = sd_wait_token(bus, 0xFE, bus->token_timeout);
+    if (rc) break;
+
+    rc = sd_spi_recv_bytes(bus, dst, 512);
+    if (rc) break;
+
+    uint8_t dummy;
+    rc  = sd_spi_recv(bus, &dummy);
+    rc |= sd_spi_recv(bus, &dummy);
+  }
+
+  uint8_t rc2 = sd_stop_transmission(bus);
+  uint8_t rc3 = sd_cs_release(bus);
+  if (rc) return rc;
+  if (rc2) return rc2;
+  return rc3;
+}
+
+uint8_t sd_write_blocks(spi_t* bus, uint32_t lba, uint32_t count,
+                        const uint8_t *src, uint8_t pre_erase){
+  if (!src) return SD_ERR_PARAM;
+  if (count == 0) return SD_OK;
+  // CMD24 is cheaper than ACMD23 + CMD25 + stop-tran for a lone block
+  if (count == 1) return sd_write_block(bus, lba, src);
+
+  uint8_t r1 = 0xFF, rc;
+
+  if (pre_erase) {
+    rc = sd_set_wr_blk_erase_count(bus, count);
+    if (rc) return rc;
+  }
+
+  rc = sd_cmd_r1(bus, 25, sd_arg_addr(lba), 0xFF, &r1);
+  if (rc) { sd_cs_release(bus); return rc; }
+  if (r1 != 0x00){ sd_cs_release(bus); return SD_ERR_BAD_R1; }
+
+  rc = sd_spi_send(bus, 0xFF); if (rc) { sd_cs_release(bus); return rc; } // stuff
+
+  for (uint32_t i = 0; i < count && !rc; i++, src += 512) {
+    rc = sd_spi_send(bus, 0xFC); // multi-block start token
+    if (rc) break;
+
+    rc = sd_spi_send_bytes(bus, src, 512);
+    if (rc) break;
+
+    // dummy CRC
+    rc  = sd_spi_send(bus, 0xFF);
+    rc |= sd_spi_send(bus, 0xFF);
+    if (rc) break;
+
+    // Data response: 0bxxx00101 => accepted
+    uint8_t resp = 0xFF;
+    rc = sd_spi_recv(bus, &resp);
+    if (rc) break;
+    if ((resp & 0x1F) != 0x05) { rc = SD_ERR_RESP; break; }
+
+    rc = sd_wait_not_busy(bus, bus->token_timeout);
+  }
+
+  // Stop-tran token ends the transfer even after an error, then one stuff byte
+  uint8_t rc2 = sd_spi_send(bus, 0xFD);
+  if (!rc2) rc2 = sd_spi_send(bus, 0xFF);
+  if (!rc2) rc2 = sd_wait_not_busy(bus, bus->token_timeout);
+
+  uint8_t rc3 = sd_cs_release(bus);
+  if (rc) return rc;
+  if (rc2) return rc2;
+  return rc3;
+}
+
+/* CMD9: card capacity in 512-byte sectors from the CSD register */
+uint8_t sd_read_sector_count(spi_t* bus, uint32_t *sectors){
+  if (!sectors) return SD_ERR_PARAM;
+
+  uint8_t r1 = 0xFF, rc;
+  rc = sd_cmd_r1(bus, 9, 0, 0xFF, &r1);
+  if (rc) { sd_cs_release(bus); return rc; }
+  if (r1 != 0x00){ sd_cs_release(bus); return SD_ERR_BAD_R1; }
+
+  rc = sd_wait_token(bus, 0xFE, bus->token_timeout);
+  if (rc) { sd_cs_release(bus); return rc; }
+
+  uint8_t csd[18]; // 16 CSD + 2 CRC
+  rc = sd_spi_recv_bytes(bus, csd, sizeof(csd));
+  uint8_t rc2 = sd_cs_release(bus);
+  if (rc) return rc;
+  if (rc2) return rc2;
+
+  if ((csd[0] >> 6) == 1) {
+    // CSD v2 (SDHC/SDXC): capacity = (C_SIZE + 1) * 512 KiB
+    uint32_t c_size = ((uint32_t)(csd[7] & 0x3F) << 16) | ((uint32_t)csd[8] << 8) | csd[9];
+    *sectors = (c_size + 1u) * 1024u;
+  } else {
+    // CSD v1: (C_SIZE + 1) * 2^(C_SIZE_MULT + 2) blocks of 2^READ_BL_LEN bytes
+    uint32_t read_bl_len = csd[5] & 0x0F;
+    uint32_t c_size = ((uint32_t)(csd[6] & 0x03) << 10) | ((uint32_t)csd[7] << 2) | (csd[8] >> 6);
+    uint32_t c_size_mult = ((uint32_t)(csd[9] & 0x03) << 1) | (csd[10] >> 7);
+    // 4 GB cards (READ_BL_LEN 11, maximum C_SIZE/C_SIZE_MULT) need 33 bits in bytes
+    *sectors = (uint32_t)(((uint64_t)(c_size + 1u) << (c_size_mult + 2u + read_bl_len)) >> 9);
+  }
+  return SD_OK;
+}
@@ -4,9 +4,35 @@
 #include <stdint.h>
 #include "variables.h"
 
+/* sd_spi_xfer_complete(bus, 0) while the transfer is still running */
+#define SD_XFER_PENDING 0x08
+
+/**
+ * Optional DMA engine for the data phase, installed by the board.
+ * start() runs a full-duplex transfer of n bytes: tx == NULL clocks 0xFF,
+ * rx == NULL discards the received bytes. poll() returns 1 once finished
+ * and sets *status (0 = ok). abort() stops a stuck transfer.
+ * All three return 0 on success like the spi_* calls.
+ */
+typedef struct {
+  uint8_t (*start)(spi_t* bus, const uint8_t *tx, uint8_t *rx, uint32_t n);
+  uint8_t (*poll)(spi_t* bus, uint8_t *status);
+  void    (*abort)(spi_t* bus);
+} sd_dma_ops_t;
+
+void sd_set_dma(const sd_dma_ops_t *ops);   // NULL = polled byte loop
+
+/* Non-blocking data transfer; without DMA start() completes synchronously */
+uint8_t sd_spi_xfer_start(spi_t* bus, const uint8_t *tx, uint8_t *rx, uint32_t n);
+uint8_t sd_spi_xfer_complete(spi_t* bus, uint8_t wait);
+
 uint8_t sd_init(spi_t* bus);
 uint8_t sd_read_block(spi_t* bus, uint32_t lba, uint8_t *dst512);
 uint8_t sd_write_block(spi_t* bus, uint32_t lba, const uint8_t *src512);
+uint8_t sd_read_blocks(spi_t* bus, uint32_t lba, uint32_t count, uint8_t *dst);
+uint8_t sd_write_blocks(spi_t* bus, uint32_t lba, uint32_t count,
+                        const uint8_t *src, uint8_t pre_erase);
+uint8_t sd_read_sector_count(spi_t* bus, uint32_t *sectors);
 uint8_t sd_is_sdhc(void);
 uint8_t sd_spi_set_hz(spi_t* bus, uint32_t hz);
 
@@ -0,0 +1,130 @@
+#include "sd_dma_samd21.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/* Descriptor and write-back tables, used only if nobody enabled the DMAC */
+static DmacDescriptor g_desc[DMAC_CH_NUM] __attribute__((aligned(16)));
+static DmacDescriptor g_wrb[DMAC_CH_NUM] __attribute__((aligned(16)));
+
+static Sercom *g_sercom = NULL;
+static uint8_t g_tx_ch, g_rx_ch, g_tx_trig, g_rx_trig;
+
+/* Source for "clock out 0xFF" and sink for "discard" transfers */
+static const uint8_t g_ff = 0xFF;
+static uint8_t g_sink;
+
+static DmacDescriptor *dma_desc(uint8_t ch){
+  return &((DmacDescriptor *)(uintptr_t)DMAC->BASEADDR.reg)[ch];
+}
+
+static void dma_channel_setup(uint8_t ch, uint8_t trigger){
+  DMAC->CHID.reg = DMAC_CHID_ID(ch);
+  DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+  DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+  while (DMAC->CHCTRLA.reg & DMAC_CHCTRLA_SWRST) {}
+  DMAC->CHCTRLB.reg = DMAC_CHCTRLB_LVL(0)
+                    | DMAC_CHCTRLB_TRIGSRC(trigger)
+                    | DMAC_CHCTRLB_TRIGACT_BEAT;
+}
+
+static void dma_channel_enable(uint8_t ch){
+  DMAC->CHID.reg = DMAC_CHID_ID(ch);
+  DMAC->CHINTFLAG.reg = DMAC_CHINTFLAG_TCMPL | DMAC_CHINTFLAG_TERR;
+  DMAC->CHCTRLA.reg |= DMAC_CHCTRLA_ENABLE;
+}
+
+static void dma_channel_disable(uint8_t ch){
+  DMAC->CHID.reg = DMAC_CHID_ID(ch);
+  DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+}
+
+uint8_t sd_dma_samd21_init(Sercom *sercom, uint8_t tx_trigger, uint8_t rx_trigger,
+                           uint8_t tx_channel, uint8_t rx_channel){
+  if (!sercom || tx_channel >= DMAC_CH_NUM || rx_channel >= DMAC_CH_NUM ||
+      tx_channel == rx_channel)
+    return 1;
+
+  PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
+  PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
+
+  if (!(DMAC->CTRL.reg & DMAC_CTRL_DMAENABLE)) {
+    DMAC->CTRL.reg = DMAC_CTRL_SWRST;
+    while (DMAC->CTRL.reg & DMAC_CTRL_SWRST) {}
+    DMAC->BASEADDR.reg = (uint32_t)(uintptr_t)g_desc;
+    DMAC->WRBADDR.reg = (uint32_t)(uintptr_t)g_wrb;
+    DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xF);
+  }
+
+  g_sercom = sercom;
+  g_tx_ch = tx_channel;
+  g_rx_ch = rx_channel;
+  g_tx_trig = tx_trigger;
+  g_rx_trig = rx_trigger;
+
+  dma_channel_setup(g_tx_ch, g_tx_trig);
+  dma_channel_setup(g_rx_ch, g_rx_trig);
+  return 0;
+}
+
+static uint8_t samd21_start(spi_t* bus, const uint8_t *tx, uint8_t *rx, uint32_t n){
+  (void)bus;
+  if (!g_sercom || n == 0 || n > 0xFFFFu) return 1;
+
+  volatile void *data = &g_sercom->SPI.DATA.reg;
+
+  // drop stale bytes so RX lines up with TX
+  while (g_sercom->SPI.INTFLAG.reg & SERCOM_SPI_INTFLAG_RXC)
+    (void)g_sercom->SPI.DATA.reg;
+
+  // Incrementing addresses point one past the end of the block
+  DmacDescriptor *d = dma_desc(g_rx_ch);
+  d->BTCTRL.reg = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BEATSIZE_BYTE |
+                  DMAC_BTCTRL_BLOCKACT_NOACT | (rx ? DMAC_BTCTRL_DSTINC : 0);
+  d->BTCNT.reg = (uint16_t)n;
+  d->SRCADDR.reg = (uint32_t)(uintptr_t)data;
+  d->DSTADDR.reg = rx ? (uint32_t)(uintptr_t)(rx + n) : (uint32_t)(uintptr_t)&g_sink;
+  d->DESCADDR.reg = 0;
+
+  d = dma_desc(g_tx_ch);
+  d->BTCTRL.reg = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BEATSIZE_BYTE |
+                  DMAC_BTCTRL_BLOCKACT_NOACT | (tx ? DMAC_BTCTRL_SRCINC : 0);
+  d->BTCNT.reg = (uint16_t)n;
+  d->SRCADDR.reg = tx ? (uint32_t)(uintptr_t)(tx + n) : (uint32_t)(uintptr_t)&g_ff;
+  d->DSTADDR.reg = (uint32_t)(uintptr_t)data;
+  d->DESCADDR.reg = 0;
+
+  // RX first, so no received byte is missed once TX starts clocking
+  dma_channel_enable(g_rx_ch);
+  dma_channel_enable(g_tx_ch);
+  return 0;
+}
+
+/* RX finishing last means every byte went out and came back */
+static uint8_t samd21_poll(spi_t* bus, uint8_t *status){
+  (void)bus;
+  DMAC->CHID.reg = DMAC_CHID_ID(g_rx_ch);
+  uint8_t flags = DMAC->CHINTFLAG.reg;
+  if (flags & DMAC_CHINTFLAG_TERR) {
+    dma_channel_disable(g_tx_ch);
+    dma_channel_disable(g_rx_ch);
+    *status = 1;
+    return 1;
+  }
+  if (flags & DMAC_CHINTFLAG_TCMPL) {
+    *status = 0;
+    return 1;
+  }
+  return 0;
+}
+
+static void samd21_abort(spi_t* bus){
+  (void)bus;
+  dma_channel_disable(g_tx_ch);
+  dma_channel_disable(g_rx_ch);
+}
+
+const sd_dma_ops_t sd_dma_samd21_ops = {
+  .start = samd21_start,
+  .poll  = samd21_poll,
+  .abort = samd21_abort
+};
@@ -0,0 +1,19 @@
+#ifndef SD_DMA_SAMD21_H
+#define SD_DMA_SAMD21_H
+
+#include <stdint.h>
+#include "samd21.h"
+#include "sd-helper.h"
+
+/**
+ * DMAC backend for sd_set_dma() on the SAMD21.
+ * Uses two channels per SERCOM: RX is triggered on RXC and TX on DRE.
+ * The SERCOM must already be configured as SPI master with RXEN set.
+ * If the DMAC is already enabled, its descriptor tables are shared.
+ */
+uint8_t sd_dma_samd21_init(Sercom *sercom, uint8_t tx_trigger, uint8_t rx_trigger,
+                           uint8_t tx_channel, uint8_t rx_channel);
+
+extern const sd_dma_ops_t sd_dma_samd21_ops;
+
+#endif /* SD_DMA_SAMD21_H */
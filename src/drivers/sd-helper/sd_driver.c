@@ -0,0 +1,86 @@
+#include "config.h"
+#include "sd_driver.h"
+#include "sd-helper.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/* The card moves 512-byte blocks; a larger logical block is SD_SPLIT of
+ * them, sent as one multi-block transfer */
+#define SD_BLOCK 512u
+#define SD_SPLIT (SECTOR_SIZE / SD_BLOCK)
+
+/* SDHC/SDXC commands carry a 32-bit block address */
+static int sd_range(uint64_t lba, uint32_t count) {
+    return (lba + count) * SD_SPLIT <= 0x100000000ull;
+}
+
+static int sd_drv_init(driver_t *self) {
+    sd_ctx_t *ctx = (sd_ctx_t *)self->ctx;
+    if (!ctx->bus) return DRIVER_ERR_PARAM;
+    if (sd_init(ctx->bus) != 0) return DRIVER_ERR_INIT;
+
+    uint32_t sectors = 0;
+    if (sd_read_sector_count(ctx->bus, &sectors) != 0) return DRIVER_ERR_INIT;
+    self->total_sectors = sectors / SD_SPLIT;
+    self->total_size_bytes = self->total_sectors * self->sector_size;
+    return DRIVER_OK;
+}
+
+static int sd_drv_read(driver_t *self, uint64_t lba, uint8_t *buf) {
+    sd_ctx_t *ctx = (sd_ctx_t *)self->ctx;
+    if (!sd_range(lba, 1)) return DRIVER_ERR_PARAM;
+    uint8_t rc = (SD_SPLIT == 1) ? sd_read_block(ctx->bus, (uint32_t)lba, buf)
+                                 : sd_read_blocks(ctx->bus, (uint32_t)(lba * SD_SPLIT), SD_SPLIT, buf);
+    return (rc == 0) ? DRIVER_OK : DRIVER_ERR_IO;
+}
+
+static int sd_drv_write(driver_t *self, uint64_t lba, const uint8_t *buf) {
+    sd_ctx_t *ctx = (sd_ctx_t *)self->ctx;
+    if (!sd_range(lba, 1)) return DRIVER_ERR_PARAM;
+    uint8_t rc = (SD_SPLIT == 1) ? sd_write_block(ctx->bus, (uint32_t)lba, buf)
+                                 : sd_write_blocks(ctx->bus, (uint32_t)(lba * SD_SPLIT), SD_SPLIT, buf,
+                                                   ctx->pre_erase);
+    return (rc == 0) ? DRIVER_OK : DRIVER_ERR_IO;
+}
+
+static int sd_drv_read_blocks(driver_t *self, uint64_t lba, uint32_t count, uint8_t *buf) {
+    sd_ctx_t *ctx = (sd_ctx_t *)self->ctx;
+    if (!sd_range(lba, count)) return DRIVER_ERR_PARAM;
+    return (sd_read_blocks(ctx->bus, (uint32_t)(lba * SD_SPLIT), count * SD_SPLIT, buf) == 0)
+        ? DRIVER_OK : DRIVER_ERR_IO;
+}
+
+static int sd_drv_write_blocks(driver_t *self, uint64_t lba, uint32_t count, const uint8_t *buf) {
+    sd_ctx_t *ctx = (sd_ctx_t *)self->ctx;
+    if (!sd_range(lba, count)) return DRIVER_ERR_PARAM;
+    return (sd_write_blocks(ctx->bus, (uint32_t)(lba * SD_SPLIT), count * SD_SPLIT, buf, ctx->pre_erase) == 0)
+        ? DRIVER_OK : DRIVER_ERR_IO;
+}
+
+/* Writes return only after the card left busy, nothing to flush */
+static int sd_drv_sync(driver_t *self) {
+    (void)self;
+    return DRIVER_OK;
+}
+
+static void sd_drv_deinit(driver_t *self) {
+    (void)self;
+}
+
+static sd_ctx_t ctx = {
+    .bus = &spi_s3,
+    .pre_erase = 1
+};
+
+driver_t sd_driver = {
+    .name = "sd",
+    .sector_size = SECTOR_SIZE,
+    .ctx = &ctx,
+    .init = sd_drv_init,
+    .read_block = sd_drv_read,
+    .write_block = sd_drv_write,
+    .read_blocks = sd_drv_read_blocks,
+    .write_blocks = sd_drv_write_blocks,
+    .sync = sd_drv_sync,
+    .deinit = sd_drv_deinit
+};
@@ -0,0 +1,16 @@
+#ifndef SD_DRIVER_H
+#define SD_DRIVER_H
+
+#include <stdint.h>
+#include "driver.h"
+#include "variables.h"
+
+typedef struct {
+    spi_t *bus;
+    uint8_t pre_erase;   ///< Send ACMD23 before every multi-block write
+} sd_ctx_t;
+
+/* driver_t over sd-helper; multi-sector ops use CMD18/CMD25 */
+extern driver_t sd_driver;
+
+#endif /* SD_DRIVER_H */
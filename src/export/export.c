@@ -0,0 +1,295 @@
+#define _POSIX_C_SOURCE 200809L
+#include "export.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define EXPORT_HAVE_SSSE3 1
+#include <immintrin.h>
+#else
+#define EXPORT_HAVE_SSSE3 0
+#endif
+
+/* ---- Hex encoding ---- */
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static void hex_encode_scalar(char *dst, const uint8_t *src, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[0] = hex_digits[src[i] >> 4];
+        dst[1] = hex_digits[src[i] & 0x0F];
+        dst[2] = ' ';
+        dst += 3;
+    }
+}
+
+#if EXPORT_HAVE_SSSE3
+/* 16 bytes -> 48 chars: nibbles via pshufb, then spread pairs into "xx " triplets */
+__attribute__((target("ssse3")))
+static void hex_encode_ssse3(char *dst, const uint8_t *src, size_t n) {
+    const __m128i digits = _mm_loadu_si128((const __m128i *)hex_digits);
+    const __m128i low4 = _mm_set1_epi8(0x0F);
+    /* 8 pairs (16 bytes) -> 24 chars, split as 16 + 8; -1 leaves a slot for ' ' */
+    const __m128i spread0 = _mm_setr_epi8(0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1, 10);
+    const __m128i spread1 = _mm_setr_epi8(11, -1, 12, 13, -1, 14, 15, -1,
+                                          -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i space0 = _mm_setr_epi8(0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0);
+    const __m128i space1 = _mm_setr_epi8(0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, 0, 0, 0, 0, 0, 0);
+
+    while (n >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)src);
+        __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), low4));
+        __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, low4));
+        __m128i pairs[2] = { _mm_unpacklo_epi8(hi, lo), _mm_unpackhi_epi8(hi, lo) };
+
+        for (int k = 0; k < 2; k++) {
+            __m128i a = _mm_or_si128(_mm_shuffle_epi8(pairs[k], spread0), space0);
+            __m128i b = _mm_or_si128(_mm_shuffle_epi8(pairs[k], spread1), space1);
+            _mm_storeu_si128((__m128i *)dst, a);
+            _mm_storel_epi64((__m128i *)(dst + 16), b);
+            dst += 24;
+        }
+        src += 16;
+        n -= 16;
+    }
+    hex_encode_scalar(dst, src, n);
+}
+#endif
+
+void hex_encode(char *dst, const uint8_t *src, size_t n) {
+#if EXPORT_HAVE_SSSE3
+    static int ssse3 = -1;
+    if (ssse3 < 0) ssse3 = __builtin_cpu_supports("ssse3");
+    if (ssse3) {
+        hex_encode_ssse3(dst, src, n);
+        return;
+    }
+#endif
+    hex_encode_scalar(dst, src, n);
+}
+
+/* ---- Little-endian helpers ---- */
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void put_le64(uint8_t *p, uint64_t v) {
+    put_le32(p, (uint32_t)v);
+    put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_le64(const uint8_t *p) {
+    return (uint64_t)get_le32(p) | ((uint64_t)get_le32(p + 4) << 32);
+}
+
+static uint64_t align64(uint64_t v) {
+    return (v + 63) & ~(uint64_t)63;
+}
+
+/* ---- Writers ---- */
+
+/* BIN/COL header for the records written so far */
+static int write_header(exporter_t *x) {
+    uint8_t hdr[EXPORT_HDR_SIZE] = { 0 };
+    memcpy(hdr, x->fmt == EXPORT_BIN ? "ZINFBIN1" : "ZINFCOL1", 8);
+    put_le32(hdr + 8, EXPORT_VERSION);
+    put_le32(hdr + 12, x->sector_size);
+    put_le32(hdr + 16, x->payload_size);
+    put_le32(hdr + 20, x->fmt == EXPORT_BIN ? x->payload_size + EXPORT_BIN_FIXED : 0);
+    put_le64(hdr + 24, x->written);
+    put_le64(hdr + 32, x->first);
+    for (int c = 0; c < EXPORT_COLUMNS; c++)
+        put_le64(hdr + 40 + 8 * c, x->col_off[c]);
+    if (fseeko(x->f, 0, SEEK_SET) != 0) return -1;
+    return fwrite(hdr, 1, sizeof(hdr), x->f) == sizeof(hdr) ? 0 : -1;
+}
+
+int export_open(exporter_t *x, export_format_t fmt, const char *path,
+                uint32_t sector_size, uint32_t payload_size, uint64_t first, int append) {
+    memset(x, 0, sizeof(*x));
+    x->fmt = fmt;
+    x->sector_size = sector_size;
+    x->payload_size = payload_size;
+    x->first = first;
+
+    if (append && fmt == EXPORT_COL) {
+        errno = EINVAL;
+        return -1;
+    }
+    x->f = fopen(path, !append ? "wb" : (fmt == EXPORT_CSV) ? "ab" : "r+b");
+    if (!x->f) return -1;
+
+    /* CSV line: status, header, 3 chars per payload byte, two CRCs */
+    size_t line = (fmt == EXPORT_CSV) ? (size_t)payload_size * 3 + 64
+                                      : (size_t)payload_size + EXPORT_BIN_FIXED;
+    x->line = malloc(line);
+    if (!x->line) {
+        fclose(x->f);
+        return -1;
+    }
+
+    if (fmt == EXPORT_CSV) {
+        if (!append)
+            fprintf(x->f, "status,header,payload(hex...),crc_stored,crc_calc\n");
+        return 0;
+    }
+
+    if (append) {
+        /* keep the original header, only the record count moves */
+        uint8_t hdr[EXPORT_HDR_SIZE];
+        if (fread(hdr, 1, sizeof(hdr), x->f) != sizeof(hdr) ||
+            memcmp(hdr, "ZINFBIN1", 8) != 0 ||
+            get_le32(hdr + 12) != sector_size || get_le32(hdr + 16) != payload_size) {
+            export_close(x);
+            errno = EINVAL;
+            return -1;
+        }
+        x->written = get_le64(hdr + 24);
+        x->first = get_le64(hdr + 32);
+        if (fseeko(x->f, (off_t)(EXPORT_HDR_SIZE + x->written * (payload_size + EXPORT_BIN_FIXED)),
+                   SEEK_SET) != 0) {
+            export_close(x);
+            return -1;
+        }
+        return 0;
+    }
+
+    for (int c = 0; c < EXPORT_COLUMNS && fmt == EXPORT_COL; c++) {
+        x->col[c] = tmpfile();
+        if (!x->col[c]) {
+            export_close(x);
+            return -1;
+        }
+    }
+    /* an empty file until close rewrites the header */
+    if (write_header(x) != 0) {
+        export_close(x);
+        return -1;
+    }
+    return 0;
+}
+
+static int export_csv(exporter_t *x, const export_batch_t *b) {
+    for (uint32_t i = 0; i < b->count; i++) {
+        char *p = x->line;
+        p += sprintf(p, "%s,%u,\"", b->status[i] ? "CRC_OK" : "CRC_FAIL", b->header[i]);
+        hex_encode(p, b->payload + (size_t)i * x->payload_size, x->payload_size);
+        p += (size_t)x->payload_size * 3;
+        p += sprintf(p, "\",%u,%u\n", b->stored_crc[i], b->calc_crc[i]);
+        if (fwrite(x->line, 1, (size_t)(p - x->line), x->f) != (size_t)(p - x->line)) return -1;
+    }
+    return 0;
+}
+
+static int export_bin(exporter_t *x, const export_batch_t *b) {
+    size_t rec = (size_t)x->payload_size + EXPORT_BIN_FIXED;
+    uint8_t *r = (uint8_t *)x->line;
+
+    for (uint32_t i = 0; i < b->count; i++) {
+        put_le32(r, (uint32_t)(b->logical ? b->logical[i] : b->first + i));
+        r[4] = b->status[i];
+        r[5] = b->header[i];
+        r[6] = (uint8_t)b->mirror[i];
+        r[7] = 0;
+        put_le32(r + 8, b->stored_crc[i]);
+        put_le32(r + 12, b->calc_crc[i]);
+        memcpy(r + EXPORT_BIN_FIXED, b->payload + (size_t)i * x->payload_size, x->payload_size);
+        if (fwrite(r, 1, rec, x->f) != rec) return -1;
+        x->written++;
+    }
+    return 0;
+}
+
+static int col_write(FILE *f, const void *src, size_t len) {
+    return fwrite(src, 1, len, f) == len ? 0 : -1;
+}
+
+static int export_col(exporter_t *x, const export_batch_t *b) {
+    /* u32 columns are staged little-endian in one scratch buffer */
+    uint8_t *le = malloc(4ull * b->count);
+    if (!le) return -1;
+
+    for (uint32_t i = 0; i < b->count; i++)
+        put_le32(le + 4 * i, (uint32_t)(b->logical ? b->logical[i] : b->first + i));
+    int rc = col_write(x->col[0], le, 4ull * b->count);
+    if (rc == 0) rc = col_write(x->col[1], b->status, b->count);
+    if (rc == 0) rc = col_write(x->col[2], b->header, b->count);
+    if (rc == 0) rc = col_write(x->col[3], b->mirror, b->count);
+    if (rc == 0) {
+        for (uint32_t i = 0; i < b->count; i++) put_le32(le + 4 * i, b->stored_crc[i]);
+        rc = col_write(x->col[4], le, 4ull * b->count);
+    }
+    if (rc == 0) {
+        for (uint32_t i = 0; i < b->count; i++) put_le32(le + 4 * i, b->calc_crc[i]);
+        rc = col_write(x->col[5], le, 4ull * b->count);
+    }
+    if (rc == 0) rc = col_write(x->col[6], b->payload, (size_t)b->count * x->payload_size);
+    if (rc == 0) x->written += b->count;
+    free(le);
+    return rc;
+}
+
+/* COL: every staged column to its 64-byte aligned offset, then the header */
+static int col_assemble(exporter_t *x) {
+    const uint64_t width[EXPORT_COLUMNS] = { 4, 1, 1, 1, 4, 4, x->payload_size };
+    uint8_t buf[1 << 16];
+    uint64_t off = EXPORT_HDR_SIZE;
+
+    for (int c = 0; c < EXPORT_COLUMNS; c++) {
+        x->col_off[c] = off;
+        off = align64(off + width[c] * x->written);
+        if (fflush(x->col[c]) != 0 || fseeko(x->col[c], 0, SEEK_SET) != 0 ||
+            fseeko(x->f, (off_t)x->col_off[c], SEEK_SET) != 0)
+            return -1;
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), x->col[c])) > 0)
+            if (fwrite(buf, 1, n, x->f) != n) return -1;
+        if (ferror(x->col[c])) return -1;
+    }
+    if (write_header(x) != 0 || fflush(x->f) != 0) return -1;
+    /* the last column ends the file, padding included */
+    return ftruncate(fileno(x->f), (off_t)(x->col_off[6] + width[6] * x->written));
+}
+
+int export_batch(exporter_t *x, const export_batch_t *b) {
+    switch (x->fmt) {
+    case EXPORT_CSV: return export_csv(x, b);
+    case EXPORT_BIN: return export_bin(x, b);
+    case EXPORT_COL: return export_col(x, b);
+    }
+    return -1;
+}
+
+int export_close(exporter_t *x) {
+    int rc = 0;
+    if (x->f) {
+        /* BIN: the header count covers exactly the records on disk */
+        if (x->fmt == EXPORT_BIN) {
+            uint8_t n[8];
+            put_le64(n, x->written);
+            if (fseeko(x->f, 24, SEEK_SET) != 0 || fwrite(n, 1, sizeof(n), x->f) != sizeof(n))
+                rc = -1;
+        }
+        if (x->fmt == EXPORT_COL && x->col[EXPORT_COLUMNS - 1] && col_assemble(x) != 0)
+            rc = -1;
+        if (fclose(x->f) != 0) rc = -1;
+    }
+    for (int c = 0; c < EXPORT_COLUMNS; c++)
+        if (x->col[c]) fclose(x->col[c]);
+    free(x->line);
+    x->f = NULL;
+    x->line = NULL;
+    memset(x->col, 0, sizeof(x->col));
+    return rc;
+}
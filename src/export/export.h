@@ -0,0 +1,82 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Reader export formats.
+ *
+ * CSV  - status,header,"payload hex",crc_stored,crc_calc (legacy layout)
+ * BIN  - header, then fixed-size records:
+ *          u32 logical, u8 status, u8 header, i8 mirror, u8 pad,
+ *          u32 crc_stored, u32 crc_calc, u8 payload[payload_size]
+ * COL  - header, then one 64-byte aligned array per column:
+ *          logical u32, status u8, header u8, mirror i8,
+ *          crc_stored u32, crc_calc u32, payload u8[payload_size]
+ *
+ * The per-record logical is the low 32 bits of the sector number;
+ * first_logical in the header carries all 64. A compressed sector
+ * (STORAGE_SECTOR_RLE) is exported by the reader as the records it holds,
+ * one per row: the same logical, status, mirror and CRCs, the user
+ * header they were written with and the decoded payload.
+ *
+ * All integers are little-endian. The BIN and COL headers are
+ * EXPORT_HDR_SIZE bytes:
+ *   0  char[8] magic ("ZINFBIN1" / "ZINFCOL1")
+ *   8  u32 version, u32 sector_size, u32 payload_size, u32 record_size (BIN) / 0
+ *   24 u64 count, u64 first_logical
+ *   40 u64 column offsets (COL only, in the order above; 0 for BIN)
+ */
+
+#define EXPORT_HDR_SIZE 128
+#define EXPORT_VERSION 1
+#define EXPORT_BIN_FIXED 16   // BIN record bytes before the payload
+#define EXPORT_COLUMNS 7
+
+typedef enum {
+    EXPORT_CSV = 0,
+    EXPORT_BIN,
+    EXPORT_COL
+} export_format_t;
+
+/* count consecutive logical sectors starting at first */
+typedef struct {
+    uint64_t first;
+    uint32_t count;
+    const uint8_t *status;      // 1 = a mirror passed CRC
+    const uint8_t *header;
+    const int8_t *mirror;       // mirror used (data slice on parity cards), -1 if none passed
+    const uint32_t *stored_crc;
+    const uint32_t *calc_crc;
+    const uint8_t *payload;     // count * payload_size
+    const uint64_t *logical;    // per record, NULL for first + i
+} export_batch_t;
+
+typedef struct {
+    export_format_t fmt;
+    FILE *f;
+    uint32_t sector_size;
+    uint32_t payload_size;
+    uint64_t written;           // records in the file, patched into the header on close
+    uint64_t first;
+    uint64_t col_off[EXPORT_COLUMNS];
+    FILE *col[EXPORT_COLUMNS];  // COL: each column staged until close
+    char *line;                 // CSV/BIN staging buffer
+} exporter_t;
+
+/*
+ * append continues an existing CSV or BIN export of the same geometry.
+ * COL columns are staged in temporary files and laid out on close, when
+ * the record count is known; COL files cannot be appended to.
+ */
+int export_open(exporter_t *x, export_format_t fmt, const char *path,
+                uint32_t sector_size, uint32_t payload_size, uint64_t first, int append);
+int export_batch(exporter_t *x, const export_batch_t *b);
+int export_close(exporter_t *x);
+
+/* "xx " per input byte into dst (3 * n bytes, not terminated) */
+void hex_encode(char *dst, const uint8_t *src, size_t n);
+
+#endif /* EXPORT_H */
@@ -0,0 +1,147 @@
+#include "records.h"
+#include "export.h"
+#include "storage.h"
+#include "config.h"
+#include "codec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_MAX (STORAGE_PACK_REC_HDR + 0xFFFF)
+#define RLE_MAX (255u * (STORAGE_BLOCK_MAX - HEADER_SIZE - CRC_SIZE))   // a full RLE sector, decoded
+#define REC_BUF (RECORD_MAX > RLE_MAX ? RECORD_MAX : RLE_MAX)
+
+int records_open(records_t *r, const char *path, int append) {
+    memset(r, 0, sizeof(*r));
+    r->rec = malloc(REC_BUF);
+    r->line = malloc((size_t)RECORD_MAX * 3 + 64);
+    r->f = fopen(path, append ? "ab" : "wb");
+    if (!r->rec || !r->line || !r->f) {
+        records_close(r);
+        return -1;
+    }
+    if (!append)
+        fprintf(r->f, "sector,offset,type,len,data(hex...)\n");
+    return 0;
+}
+
+int records_close(records_t *r) {
+    int rc = 0;
+    if (r->f && fclose(r->f) != 0) rc = -1;
+    free(r->rec);
+    free(r->line);
+    r->f = NULL;
+    r->rec = NULL;
+    r->line = NULL;
+    return rc;
+}
+
+void records_resume(records_t *r, uint64_t sector, uint16_t offset, uint64_t until) {
+    r->resume_sector = sector;
+    r->resume_offset = offset;
+    r->resume_until = until;
+}
+
+uint64_t records_open_sector(const records_t *r, uint16_t *offset) {
+    if (!r->in_record) return 0;
+    *offset = r->rec_offset;
+    return r->rec_sector;
+}
+
+static void drop(records_t *r) {
+    if (r->in_record) r->dropped++;
+    r->in_record = 0;
+    r->synced = 0;
+}
+
+static void emit_row(records_t *r, uint64_t sector, uint32_t offset, uint8_t type,
+                     const uint8_t *data, uint32_t len) {
+    char *p = r->line;
+    p += sprintf(p, "%llu,%u,%u,%u,\"", (unsigned long long)sector, offset, type, len);
+    hex_encode(p, data, len);
+    p += (size_t)len * 3;
+    p += sprintf(p, "\"\n");
+    fwrite(r->line, 1, (size_t)(p - r->line), r->f);
+    r->records++;
+}
+
+static void emit(records_t *r) {
+    emit_row(r, r->rec_sector, r->rec_offset, r->rec[0], r->rec + STORAGE_PACK_REC_HDR,
+             r->need - STORAGE_PACK_REC_HDR);
+}
+
+/* Compressed sectors stand alone: one row per record, offset is its index */
+static void rle_sector(records_t *r, uint64_t logical, const uint8_t *payload,
+                       uint32_t payload_size) {
+    if (logical < r->resume_until) return;
+    uint8_t header;
+    int k = codec_sector_decode(payload, payload_size, payload_size, r->rec,
+                                REC_BUF / payload_size, &header);
+    if (k < 0) {
+        r->dropped++;
+        return;
+    }
+    for (int i = 0; i < k; i++)
+        emit_row(r, logical, (uint32_t)i, header, r->rec + (size_t)i * payload_size, payload_size);
+}
+
+void records_sector(records_t *r, uint64_t logical, uint8_t header, uint8_t valid,
+                    const uint8_t *payload, uint32_t payload_size) {
+    if (!valid) {
+        drop(r);        // might have been a packed sector we needed
+        return;
+    }
+    if (header == STORAGE_SECTOR_RLE) {
+        rle_sector(r, logical, payload, payload_size);
+        return;
+    }
+    if (header != STORAGE_SECTOR_PACKED) return;   // raw appends interleave freely
+
+    const uint8_t *stream = payload + 2;
+    uint32_t area = payload_size - 2;
+    uint32_t first = payload[0] | (payload[1] << 8);
+    uint32_t pos = 0;
+
+    if (r->resume_sector && logical == r->resume_sector) {
+        drop(r);
+        pos = r->resume_offset;
+        r->synced = 1;
+        r->resume_sector = 0;
+    } else if (r->in_record) {
+        // the open record must end exactly where this sector says the next begins
+        uint32_t left = r->need ? r->need - r->have : STORAGE_PACK_REC_HDR - r->have;
+        if (first != STORAGE_PACK_NONE && r->need && left != first) {
+            drop(r);
+        } else if (first == STORAGE_PACK_NONE && r->need && left < area) {
+            drop(r);
+        }
+    }
+    if (!r->synced && !r->in_record) {
+        if (first == STORAGE_PACK_NONE || first >= area) return;
+        pos = first;
+        r->synced = 1;
+    }
+
+    while (pos < area) {
+        if (!r->in_record) {
+            if (stream[pos] == STORAGE_PACK_PAD) break;
+            r->in_record = 1;
+            r->have = r->need = 0;
+            r->rec_sector = logical;
+            r->rec_offset = (uint16_t)pos;
+        }
+
+        uint32_t want = r->need ? r->need - r->have : STORAGE_PACK_REC_HDR - r->have;
+        uint32_t k = (area - pos < want) ? area - pos : want;
+        memcpy(r->rec + r->have, stream + pos, k);
+        r->have += k;
+        pos += k;
+
+        if (!r->need && r->have == STORAGE_PACK_REC_HDR)
+            r->need = STORAGE_PACK_REC_HDR + (r->rec[1] | (r->rec[2] << 8));
+        if (r->need && r->have == r->need) {
+            emit(r);
+            r->in_record = 0;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef RECORDS_H
+#define RECORDS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Decoder for the packed record stream (STORAGE_SECTOR_PACKED sectors,
+ * layout in storage.h). Sectors are fed in logical order; every complete
+ * record becomes one CSV row:
+ *   sector,offset,type,len,"data hex..."
+ * where sector/offset locate the record's first byte. A record cut by a
+ * corrupt sector is dropped and decoding resyncs on the next packed
+ * sector's first-record offset.
+ *
+ * Compressed sectors (STORAGE_SECTOR_RLE) are self-contained and give one
+ * row per record: offset is the record's index in the sector and type is
+ * the user header it was written with.
+ */
+
+typedef struct {
+    FILE *f;
+    uint8_t *rec;               // record being assembled, header included
+    char *line;
+    uint32_t have, need;        // need is 0 until the 3-byte header is in
+    int in_record;
+    int synced;                 // 0: wait for a sector's first-record offset
+    uint64_t rec_sector;        // where the record being assembled starts
+    uint16_t rec_offset;
+    uint64_t resume_sector;     // see records_resume()
+    uint16_t resume_offset;
+    uint64_t resume_until;      // compressed sectors below this were already emitted
+    uint64_t records, dropped;
+} records_t;
+
+int records_open(records_t *r, const char *path, int append);
+void records_sector(records_t *r, uint64_t logical, uint8_t header, uint8_t valid,
+                    const uint8_t *payload, uint32_t payload_size);
+int records_close(records_t *r);
+
+/* Start at a known record boundary instead of the next first-record offset;
+ * sectors before until are only replayed to re-assemble that record */
+void records_resume(records_t *r, uint64_t sector, uint16_t offset, uint64_t until);
+
+/* Start of the record still open at the end of the input, 0 if none */
+uint64_t records_open_sector(const records_t *r, uint16_t *offset);
+
+#endif /* RECORDS_H */
@@ -0,0 +1,60 @@
+#include "samples.h"
+#include "columns.h"
+#include "storage.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define VALUES_MAX ((size_t)COLUMNS_CHANNELS_MAX * COLUMNS_FRAMES_MAX)
+#define LINE_MAX_BYTES (64 + COLUMNS_CHANNELS_MAX * 12)
+
+int samples_open(samples_t *s, const char *path, int append) {
+    memset(s, 0, sizeof(*s));
+    s->values = malloc(VALUES_MAX * sizeof(*s->values));
+    s->line = malloc(LINE_MAX_BYTES);
+    s->f = fopen(path, append ? "ab" : "wb");
+    if (!s->values || !s->line || !s->f) {
+        samples_close(s);
+        return -1;
+    }
+    if (!append)
+        fprintf(s->f, "sector,frame,type,values(ch0 ch1 ...)\n");
+    return 0;
+}
+
+int samples_close(samples_t *s) {
+    int rc = 0;
+    if (s->f && fclose(s->f) != 0) rc = -1;
+    free(s->values);
+    free(s->line);
+    s->f = NULL;
+    s->values = NULL;
+    s->line = NULL;
+    return rc;
+}
+
+void samples_sector(samples_t *s, uint64_t logical, uint8_t header, uint8_t valid,
+                    const uint8_t *payload, uint32_t payload_size) {
+    if (!valid || header != STORAGE_SECTOR_COLUMNS) return;
+
+    uint8_t type, ch, user;
+    int n = columns_decode(payload, payload_size, s->values, VALUES_MAX, &type, &ch, &user);
+    if (n < 0) {
+        s->dropped++;
+        return;
+    }
+
+    for (int f = 0; f < n; f++) {
+        char *p = s->line;
+        p += sprintf(p, "%llu,%d,%u,\"", (unsigned long long)logical, f, user);
+        for (uint8_t c = 0; c < ch; c++) {
+            int32_t v = s->values[(size_t)c * n + f];
+            if (type == 4) p += sprintf(p, "%u ", (uint32_t)v);
+            else p += sprintf(p, "%d ", v);
+        }
+        p[-1] = '"';
+        *p++ = '\n';
+        fwrite(s->line, 1, (size_t)(p - s->line), s->f);
+    }
+    s->frames += (uint64_t)n;
+}
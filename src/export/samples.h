@@ -0,0 +1,28 @@
+#ifndef SAMPLES_H
+#define SAMPLES_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Decoder for column-wise sample sectors (STORAGE_SECTOR_COLUMNS, layout
+ * in columns.h). Every frame becomes one CSV row:
+ *   sector,frame,type,"ch0 ch1 ..."
+ * with type the user header and values in decimal, unsigned types
+ * printed unsigned. Sectors stand alone, so a corrupt one only loses its
+ * own frames.
+ */
+
+typedef struct {
+    FILE *f;
+    int32_t *values;            // one decoded sector, column-wise
+    char *line;
+    uint64_t frames, dropped;
+} samples_t;
+
+int samples_open(samples_t *s, const char *path, int append);
+void samples_sector(samples_t *s, uint64_t logical, uint8_t header, uint8_t valid,
+                    const uint8_t *payload, uint32_t payload_size);
+int samples_close(samples_t *s);
+
+#endif /* SAMPLES_H */
@@ -1,16 +1,59 @@
+#include "config.h"
 #include "driver.h"
+#include "linux_driver.h"
+#include "multi_driver.h"
+#include "ram_driver.h"
 #include "storage.h"
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
-extern driver_t linux_driver;
 driver_t *active_driver = &linux_driver;
 uint32_t log_sector = 0;  // global required by storage.c
 uint8_t status;
 
-int main(void) {
+int main(int argc, char *argv[]) {
     printf("=== MyFS Desktop Test ===\n");
 
+    /* ./zinf [linux|uring [device]] | [mmap <image> [size_mb]] | [ram [size_mb]]
+     *        | [multi <device> <device>...] (one mirror per device, round-robin) */
+    const char *drv = (argc > 1) ? argv[1] : "linux";
+    const char *arg = (argc > 2) ? argv[2] : NULL;
+    if (strcmp(drv, "uring") == 0) {
+        active_driver = &uring_driver;
+        if (arg) uring_driver_set_path(arg);
+    } else if (strcmp(drv, "mmap") == 0) {
+        if (!arg) {
+            printf("mmap needs an image path\n");
+            return 1;
+        }
+        uint64_t mb = (argc > 3) ? strtoull(argv[3], NULL, 10) : 0;
+        mmap_driver_configure(arg, mb * 1024u * 1024u);
+        active_driver = &mmap_driver;
+    } else if (strcmp(drv, "ram") == 0) {
+        uint64_t mb = arg ? strtoull(arg, NULL, 10) : 5;
+        ram_driver_configure(NULL, mb * 1024u * 1024u);
+        active_driver = &ram_driver;
+    } else if (strcmp(drv, "multi") == 0) {
+        static driver_t devs[MULTI_DEVICES_MAX];
+        static linux_ctx_t ctxs[MULTI_DEVICES_MAX];
+        driver_t *members[MULTI_DEVICES_MAX];
+        int n = argc - 2;
+        if (n < 1 || n > MULTI_DEVICES_MAX) {
+            printf("multi needs 1..%d devices\n", MULTI_DEVICES_MAX);
+            return 1;
+        }
+        for (int i = 0; i < n; i++) {
+            linux_driver_instance(&devs[i], &ctxs[i], argv[2 + i]);
+            members[i] = &devs[i];
+        }
+        multi_driver_configure(members, (uint8_t)n, 0);
+        active_driver = &multi_driver;
+    } else if (arg) {
+        linux_driver_set_path(arg);
+    }
+
     status = setup_storage();
     if (status != 0) {
         printf("Storage init failed.\n");
@@ -24,7 +67,7 @@ int main(void) {
     }
 
     uint8_t header = 0xAB;
-    uint8_t payload[507];
+    uint8_t payload[PAYLOAD_SIZE];
     for (size_t i = 0; i < sizeof(payload); i++) payload[i] = 12;
 
     printf("Writing test sector...\n");
@@ -48,6 +91,11 @@ int main(void) {
 
     printf("Write OK\n");
 
+    if (storage_flush() != STORAGE_OK) {
+        printf("storage_flush failed\n");
+        return 1;
+    }
+
     active_driver->deinit(active_driver);
     return 0;
 }
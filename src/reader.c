@@ -1,21 +1,61 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
-
-#include "core/config.h"
+#include <pthread.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "codec.h"
+#include "crc32.h"
+#include "erasure.h"
+#include "export.h"
+#include "records.h"
+#include "samples.h"
+#include "scan.h"
+#include "storage.h"
 
 /* COMPILATION:
- *   gcc -O2 -o ./reader ./reader.c ./core/config.c -I./core
+ *   make reader
  *
  * USAGE:
- *   sudo ./reader /dev/sdb
+ *   sudo ./reader [-j threads] [-f csv|bin|col] [-q] [-i] /dev/sdb
+ *
+ *   -f  payload export format (default csv), see export.h; compressed
+ *       sectors are exported as the records they hold
+ *   -q  no per-sector terminal output
+ *   -i  incremental: only export sectors added since the last run and
+ *       append them (csv/bin); falls back to a full run if the checkpoint
+ *       does not match the card
  */
 
 #define SUPER_SECTOR_1 0
 #define SUPER_SECTOR_2 1
 #define PATH_PAYLOAD "./.out/payload.csv"
+#define PATH_PAYLOAD_BIN "./.out/payload.bin"
+#define PATH_PAYLOAD_COL "./.out/payload.col"
 #define PATH_METADATA "./.out/meta.csv"
+#define PATH_RECORDS "./.out/records.csv"
+#define PATH_SAMPLES "./.out/samples.csv"
+#define PATH_CHECKPOINT "./.out/checkpoint"
+#define TAIL_SECTORS 16     /* exported sectors covered by the checkpoint CRC */
+#define MIRRORS_MAX 8
+#define CHUNK_SECTORS 4096  /* logical sectors verified per worker per round */
+#define THREADS_MAX 64
+#define RLE_RECORDS_MAX 255 /* records in one compressed sector (u8 count) */
+
+/* Logical block size of the card, see detect_block_size() */
+static uint32_t block_size = SECTOR_SIZE;
+static uint32_t payload_size = PAYLOAD_SIZE;
+
+/* Redundancy layout from superblock bytes 11..12: slices of RAID_OFFSET
+ * sectors, RAID_MIRRORS mirrors or ec_k data + ec_m parity columns
+ * (logical L >= 2 is column (L - 2) % ec_k of row 2 + (L - 2) / ec_k) */
+static uint32_t slices = RAID_MIRRORS;
+static uint8_t ec_k = 0, ec_m = 0;
+static uint64_t last_sector = 0;
 
 /* ---- Terminal colors ---- */
 #define CLR_RESET  "\033[0m"
@@ -25,172 +65,688 @@
 #define CLR_CYAN   "\033[36m"
 #define CLR_MAG    "\033[35m"
 
-/* ---- CRC32 (same as firmware) ---- */
-uint32_t crc32_u8bit(const uint8_t *data, size_t len) {
-    uint32_t crc = 0xFFFFFFFF;
-    for (size_t i = 0; i < len; i++) {
-        crc ^= data[i];
-        for (int j = 0; j < 8; j++) {
-            if (crc & 1)
-                crc = (crc >> 1) ^ 0xEDB88320;
-            else
-                crc >>= 1;
+/* ---- Verification result of one logical sector ---- */
+typedef struct {
+    int chosen;                      // first mirror with a valid CRC, -1 if none
+    uint8_t read_ok[MIRRORS_MAX];
+    uint8_t crc_ok[MIRRORS_MAX];
+    uint8_t header[MIRRORS_MAX];
+    uint32_t stored_crc[MIRRORS_MAX];
+    uint32_t calc_crc[MIRRORS_MAX];
+    int rebuilt;                     // parity cards: rebuilt from the rest of the row
+} sector_result_t;
+
+/* One worker: its own streams and result buffers, reused every round */
+typedef struct {
+    scan_stream_t streams[MIRRORS_MAX];
+    uint64_t first;
+    uint32_t count;
+    sector_result_t *res;           // CHUNK_SECTORS entries
+    uint8_t *payload;               // CHUNK_SECTORS * payload_size, copy in use
+    /* export columns, the copy in use */
+    uint8_t status[CHUNK_SECTORS];
+    uint8_t header[CHUNK_SECTORS];
+    int8_t mirror[CHUNK_SECTORS];
+    uint32_t stored_crc[CHUNK_SECTORS];
+    uint32_t calc_crc[CHUNK_SECTORS];
+    uint32_t ok, bad, rebuilt;
+} worker_t;
+
+static uint32_t sector_crc(const uint8_t *sec) {
+    return sec[block_size - 4] | (sec[block_size - 3] << 8) | (sec[block_size - 2] << 16) |
+           ((uint32_t)sec[block_size - 1] << 24);
+}
+
+/* Rebuild column want of row into out from the other written columns and
+ * the parity, as storage.c does; 0 if the CRC of the result holds */
+static int rebuild_column(worker_t *w, uint64_t row, uint8_t want, uint8_t *out) {
+    uint8_t syn[EC_PARITY_MAX][STORAGE_BLOCK_MAX];
+    uint8_t rows[EC_PARITY_MAX], lost[EC_PARITY_MAX];
+    uint8_t nrows = 0, nlost = 0;
+    uint64_t first = 2 + (row - 2) * ec_k;
+    uint8_t width = (last_sector - first + 1 < ec_k) ? (uint8_t)(last_sector - first + 1) : ec_k;
+
+    for (uint8_t j = 0; j < ec_m; j++) {
+        const uint8_t *sec = scan_stream_get(&w->streams[ec_k + j], row);
+        if (!sec) continue;
+        memcpy(syn[nrows], sec, block_size);
+        rows[nrows++] = j;
+    }
+    lost[nlost++] = want;
+    for (uint8_t c = 0; c < width; c++) {
+        if (c == want) continue;
+        const uint8_t *sec = scan_stream_get(&w->streams[c], row);
+        if (sec && sector_crc(sec) == crc32(sec, HEADER_SIZE + payload_size)) {
+            for (uint8_t r = 0; r < nrows; r++)
+                ec_mul_add(syn[r], sec, block_size, ec_coef(rows[r], c));
+            continue;
+        }
+        if (nlost >= nrows) return -1;
+        lost[nlost++] = c;
+    }
+    for (uint8_t r = 0; r + nlost <= nrows; r++) {
+        const uint8_t *use[EC_PARITY_MAX] = { syn[r], syn[nrows - 1] };
+        ec_solve(out, use, rows + r, lost, nlost, 0, block_size);
+        if (sector_crc(out) == crc32(out, HEADER_SIZE + payload_size)) return 0;
+    }
+    return -1;
+}
+
+/* Parity cards: one copy per sector, rebuilt when it is bad */
+static void verify_column(worker_t *w, uint64_t logical, sector_result_t *r, uint8_t *payload) {
+    uint8_t out[STORAGE_BLOCK_MAX];
+    uint64_t row = 2 + (logical - 2) / ec_k;
+    uint8_t col = (uint8_t)((logical - 2) % ec_k);
+    const uint8_t *sec = scan_stream_get(&w->streams[col], row);
+
+    if (sec) {
+        r->read_ok[col] = 1;
+        r->header[col] = sec[0];
+        r->stored_crc[col] = sector_crc(sec);
+        r->calc_crc[col] = crc32(sec, HEADER_SIZE + payload_size);
+        r->crc_ok[col] = (r->stored_crc[col] == r->calc_crc[col]);
+        memcpy(payload, &sec[HEADER_SIZE], payload_size);
+    }
+    if (r->crc_ok[col]) {
+        r->chosen = col;
+    } else if (rebuild_column(w, row, col, out) == 0) {
+        r->chosen = col;
+        r->rebuilt = 1;
+        r->read_ok[col] = r->crc_ok[col] = 1;
+        r->header[col] = out[0];
+        r->stored_crc[col] = r->calc_crc[col] = sector_crc(out);
+        memcpy(payload, &out[HEADER_SIZE], payload_size);
+        w->rebuilt++;
+    }
+}
+
+/* ---- Read and CRC every mirror of [first, first + count) ---- */
+static void *verify_range(void *arg) {
+    worker_t *w = arg;
+
+    for (uint32_t i = 0; i < w->count; i++) {
+        uint64_t logical = w->first + i;
+        sector_result_t *r = &w->res[i];
+        uint8_t *payload = w->payload + (size_t)i * payload_size;
+
+        memset(r, 0, sizeof(*r));
+        memset(payload, 0, payload_size);
+        r->chosen = -1;
+        for (uint32_t m = 0; m < RAID_MIRRORS && !ec_k; m++) {
+            const uint8_t *sec = scan_stream_get(&w->streams[m], logical);
+            if (!sec) continue;
+
+            r->read_ok[m] = 1;
+            r->header[m] = sec[0];
+            r->stored_crc[m] = sector_crc(sec);
+            r->calc_crc[m] = crc32(sec, HEADER_SIZE + payload_size);
+            r->crc_ok[m] = (r->stored_crc[m] == r->calc_crc[m]);
+
+            /* keep mirror 0 as the fallback copy, replace it with the first valid one */
+            if (r->chosen < 0 && (m == 0 || r->crc_ok[m]))
+                memcpy(payload, &sec[HEADER_SIZE], payload_size);
+            if (r->chosen < 0 && r->crc_ok[m]) r->chosen = (int)m;
+        }
+        if (ec_k) verify_column(w, logical, r, payload);
+        int use = (r->chosen >= 0) ? r->chosen : ec_k ? (int)((logical - 2) % ec_k) : 0;
+        w->status[i] = (r->chosen >= 0);
+        w->header[i] = r->header[use];
+        w->mirror[i] = (int8_t)r->chosen;
+        w->stored_crc[i] = r->stored_crc[use];
+        w->calc_crc[i] = r->calc_crc[use];
+        if (r->chosen >= 0) w->ok++;
+        else w->bad++;
+    }
+    return NULL;
+}
+
+/* ---- Print a verified range ---- */
+static void print_range(const worker_t *w) {
+    for (uint32_t i = 0; i < w->count; i++) {
+        uint64_t logical = w->first + i;
+        const sector_result_t *r = &w->res[i];
+
+        printf(CLR_YELLOW "\nLogical sector %" PRIu64 "\n" CLR_RESET, logical);
+        printf("------------------------------------------------------------\n");
+
+        /* parity cards: the one data column (its rebuilt CRCs if it was bad) */
+        uint32_t m0 = ec_k ? (uint32_t)((logical - 2) % ec_k) : 0;
+        for (uint32_t m = m0; m < (ec_k ? m0 + 1 : RAID_MIRRORS); m++) {
+            uint64_t physical = ec_k ? 2 + (logical - 2) / ec_k + m * RAID_OFFSET
+                                     : logical + m * RAID_OFFSET;
+            if (!r->read_ok[m]) {
+                fprintf(stderr, CLR_RED "Read failed for sector %" PRIu64 " (mirror %u)\n" CLR_RESET,
+                        physical, m);
+                continue;
+            }
+            printf(" %s %u @ sector %-8" PRIu64 "  Header: 0x%02X  Stored CRC: 0x%08X  Calc CRC: 0x%08X  [%s]\n",
+                   ec_k ? "Slice " : "Mirror", m, physical, r->header[m], r->stored_crc[m], r->calc_crc[m],
+                   r->crc_ok[m] ? (CLR_GREEN "OK" CLR_RESET) : (CLR_RED "BAD" CLR_RESET));
+        }
+
+        printf(" -> Result: %s (using %s %d)\n",
+               (r->chosen >= 0) ? (CLR_GREEN "VALID" CLR_RESET) : (CLR_RED "CORRUPTED" CLR_RESET),
+               r->rebuilt ? "parity for slice" : ec_k ? "slice" : "mirror",
+               (r->chosen >= 0) ? r->chosen : 0);
+    }
+}
+
+/* Records of one compressed sector, one export row each */
+static struct {
+    uint8_t *payload;               // RLE_RECORDS_MAX * payload_size
+    uint64_t logical[RLE_RECORDS_MAX];
+    uint8_t status[RLE_RECORDS_MAX];
+    uint8_t header[RLE_RECORDS_MAX];
+    int8_t mirror[RLE_RECORDS_MAX];
+    uint32_t stored_crc[RLE_RECORDS_MAX];
+    uint32_t calc_crc[RLE_RECORDS_MAX];
+} unpacked;
+
+static int export_sectors(exporter_t *x, const worker_t *w, uint32_t i, uint32_t n) {
+    export_batch_t b = {
+        .first = w->first + i,
+        .count = n,
+        .status = w->status + i,
+        .header = w->header + i,
+        .mirror = w->mirror + i,
+        .stored_crc = w->stored_crc + i,
+        .calc_crc = w->calc_crc + i,
+        .payload = w->payload + (size_t)i * payload_size
+    };
+    return export_batch(x, &b);
+}
+
+/* A valid compressed sector as its records, with their user header; one
+ * that does not decode is exported as stored */
+static int export_unpacked(exporter_t *x, const worker_t *w, uint32_t i) {
+    uint8_t user;
+    int k = codec_sector_decode(w->payload + (size_t)i * payload_size, payload_size, payload_size,
+                                unpacked.payload, RLE_RECORDS_MAX, &user);
+    if (k <= 0) return export_sectors(x, w, i, 1);
+
+    for (int r = 0; r < k; r++) {
+        unpacked.logical[r] = w->first + i;
+        unpacked.status[r] = w->status[i];
+        unpacked.header[r] = user;
+        unpacked.mirror[r] = w->mirror[i];
+        unpacked.stored_crc[r] = w->stored_crc[i];
+        unpacked.calc_crc[r] = w->calc_crc[i];
+    }
+    export_batch_t b = {
+        .first = w->first + i,
+        .count = (uint32_t)k,
+        .status = unpacked.status,
+        .header = unpacked.header,
+        .mirror = unpacked.mirror,
+        .stored_crc = unpacked.stored_crc,
+        .calc_crc = unpacked.calc_crc,
+        .payload = unpacked.payload,
+        .logical = unpacked.logical
+    };
+    return export_batch(x, &b);
+}
+
+/* Runs of stored sectors go out as they are, compressed ones unpacked */
+static int export_range(exporter_t *x, const worker_t *w) {
+    uint32_t run = 0;
+    for (uint32_t i = 0; i < w->count; i++) {
+        if (!w->status[i] || w->header[i] != STORAGE_SECTOR_RLE) {
+            run++;
+            continue;
         }
+        if ((run && export_sectors(x, w, i - run, run) != 0) || export_unpacked(x, w, i) != 0)
+            return -1;
+        run = 0;
+    }
+    return run ? export_sectors(x, w, w->count - run, run) : 0;
+}
+
+static void decode_range(records_t *recs, const worker_t *w) {
+    for (uint32_t i = 0; i < w->count; i++)
+        records_sector(recs, w->first + i, w->header[i], w->status[i],
+                       w->payload + (size_t)i * payload_size, payload_size);
+}
+
+static void sample_range(samples_t *smp, const worker_t *w) {
+    for (uint32_t i = 0; i < w->count; i++)
+        samples_sector(smp, w->first + i, w->header[i], w->status[i],
+                       w->payload + (size_t)i * payload_size, payload_size);
+}
+
+/* ---- Sidecar checkpoint of the last run ---- */
+typedef struct {
+    char format[8];
+    uint32_t sector_size;
+    uint64_t total_sectors;
+    uint64_t last_exported;         // last logical sector in the export, the tail then
+    uint32_t tail_crc;              // see tail_crc()
+    uint64_t pack_sector;           // packed record still open at the tail, 0 if none
+    uint32_t pack_offset;
+} checkpoint_t;
+
+static int load_checkpoint(const char *path, checkpoint_t *cp) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    unsigned version = 0;
+    int n = fscanf(f, "zinf-reader-checkpoint %u format %7s sector_size %u total_sectors %" SCNu64
+                      " last_exported %" SCNu64 " tail_crc %x pack_open %" SCNu64 " %u",
+                   &version, cp->format, &cp->sector_size, &cp->total_sectors,
+                   &cp->last_exported, &cp->tail_crc, &cp->pack_sector, &cp->pack_offset);
+    fclose(f);
+    return (n == 8 && version == 3) ? 0 : -1;
+}
+
+/* write-then-rename, so a crash never leaves a half-written checkpoint */
+static int save_checkpoint(const char *path, const checkpoint_t *cp) {
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return -1;
+    fprintf(f, "zinf-reader-checkpoint 3\nformat %s\nsector_size %u\ntotal_sectors %" PRIu64 "\n"
+               "last_exported %" PRIu64 "\ntail_crc 0x%08x\npack_open %" PRIu64 " %u\n",
+            cp->format, cp->sector_size, cp->total_sectors,
+            cp->last_exported, cp->tail_crc, cp->pack_sector, cp->pack_offset);
+    if (fclose(f) != 0) return -1;
+    return rename(tmp, path);
+}
+
+/* CRC of the exported records (header, payload, status) of the
+ * TAIL_SECTORS logical sectors ending at last */
+static uint32_t tail_crc(worker_t *w, uint64_t last) {
+    uint64_t first = (last >= 2 + TAIL_SECTORS) ? last - TAIL_SECTORS + 1 : 2;
+    uint32_t ok = w->ok, bad = w->bad, rebuilt = w->rebuilt;
+
+    w->first = first;
+    w->count = (uint32_t)(last - first + 1);
+    verify_range(w);
+    w->ok = ok;
+    w->bad = bad;
+    w->rebuilt = rebuilt;
+
+    uint32_t crc = 0;
+    for (uint32_t i = 0; i < w->count; i++) {
+        crc = crc32_update(crc, &w->header[i], 1);
+        crc = crc32_update(crc, w->payload + (size_t)i * payload_size, payload_size);
+        crc = crc32_update(crc, &w->status[i], 1);
     }
-    return crc ^ 0xFFFFFFFF;
+    return crc;
 }
 
-/* ---- Read exactly N bytes ---- */
-int read_bytes(FILE *f, void *buf, size_t n) {
-    size_t r = fread(buf, 1, n, f);
-    return (r == n) ? 0 : -1;
+static uint32_t le32_at(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
 }
 
-/* ---- Detect drive geometry ---- */
-uint32_t detect_total_sectors(FILE *f) {
-    fseek(f, 0, SEEK_END);
-    long total_bytes = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    if (total_bytes <= 0) return 0;
-    return (uint32_t)(total_bytes / SECTOR_SIZE);
+/* Slices a superblock describes, and its tail (64-bit from version 2) */
+static uint32_t sb_slices(const uint8_t *sb) {
+    return sb[11] ? (uint32_t)sb[11] + sb[12] : RAID_MIRRORS;
+}
+
+static uint64_t sb_tail(const uint8_t *sb) {
+    uint64_t v = 0;
+    if (sb[10] < 2) return sb[0] | (sb[1] << 8) | (sb[2] << 16);
+    for (int i = 7; i >= 0; i--) v = (v << 8) | sb[16 + i];
+    return v;
+}
+
+/* A superblock copy of a card with b-byte blocks in a layout of n slices:
+ * valid CRC, names that size in byte 9 (0 on cards from before it was
+ * recorded, which use 512) and that layout, and a tail that reaches the
+ * message sector (an empty one is a zeroed, sealed superblock too). */
+static int sb_valid(const uint8_t *sb, uint32_t b, uint32_t n) {
+    if (le32_at(sb + b - CRC_SIZE) != crc32(sb, b - CRC_SIZE)) return 0;
+    if (!((sb[9] && sb[9] <= 12 && (1u << sb[9]) == b) || (sb[9] == 0 && b == 512))) return 0;
+    return sb_slices(sb) == n && sb_tail(sb) >= SUPER_SECTOR_2;
+}
+
+/* Majority of the valid copies at the slice starts of an n-slice layout
+ * (ties: lowest slice) into sb; 0 if there is none */
+static int vote_superblock(scan_dev_t *dev, uint32_t b, uint32_t n, uint8_t *sb) {
+    static uint8_t copies[MIRRORS_MAX][STORAGE_BLOCK_MAX];
+    uint8_t valid[MIRRORS_MAX] = { 0 };
+    uint64_t offset = dev->total_sectors / n;
+    int best = -1;
+    uint32_t best_votes = 0;
+
+    for (uint32_t i = 0; i < n && offset; i++)
+        valid[i] = scan_read(dev, i * offset, 1, copies[i]) == 0 && sb_valid(copies[i], b, n);
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t votes = 0;
+        for (uint32_t j = 0; j < n && valid[i]; j++)
+            votes += valid[j] && sb_tail(copies[j]) == sb_tail(copies[i]);
+        if (votes > best_votes) {
+            best = (int)i;
+            best_votes = votes;
+        }
+    }
+    if (best < 0) return 0;
+    memcpy(sb, copies[best], b);
+    return 1;
+}
+
+/* Block size the card was formatted with and its superblock, voted as
+ * mount does: the layout copy 0 names first, then (copy 0 lost) every
+ * other one. 0 if no size has a valid copy. */
+static uint32_t find_superblock(const char *path, uint8_t *sb) {
+    static const uint32_t sizes[] = { 512, 1024, 2048, 4096 };
+    uint32_t found = 0;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]) && !found; i++) {
+        uint32_t b = sizes[i];
+        scan_dev_t dev;
+        if (scan_open(&dev, path, b) != 0) break;
+
+        uint32_t first = RAID_MIRRORS;
+        if (scan_read(&dev, SUPER_SECTOR_1, 1, sb) == 0 && sb_valid(sb, b, sb_slices(sb)))
+            first = sb_slices(sb);
+        for (uint32_t t = 0; t <= MIRRORS_MAX && !found; t++) {
+            uint32_t n = t ? t : first;
+            if ((t && n == first) || n > MIRRORS_MAX) continue;
+            if (vote_superblock(&dev, b, n, sb)) found = b;
+        }
+        scan_close(&dev);
+    }
+    return found;
 }
 
 int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <device_or_file>\n", argv[0]);
+    uint32_t threads = 1;
+    export_format_t fmt = EXPORT_CSV;
+    const char *payload_path = PATH_PAYLOAD;
+    const char *format_name = "csv";
+    int quiet = 0, incremental = 0, usage = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:f:qi")) != -1) {
+        switch (opt) {
+        case 'j': threads = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'q': quiet = 1; break;
+        case 'i': incremental = 1; break;
+        case 'f':
+            if (strcmp(optarg, "csv") == 0) {
+                fmt = EXPORT_CSV; payload_path = PATH_PAYLOAD;
+            } else if (strcmp(optarg, "bin") == 0) {
+                fmt = EXPORT_BIN; payload_path = PATH_PAYLOAD_BIN;
+            } else if (strcmp(optarg, "col") == 0) {
+                fmt = EXPORT_COL; payload_path = PATH_PAYLOAD_COL;
+            } else {
+                usage = 1;
+            }
+            format_name = optarg;
+            break;
+        default: usage = 1; break;
+        }
+    }
+    if (usage || optind >= argc) {
+        fprintf(stderr, "Usage: %s [-j threads] [-f csv|bin|col] [-q] [-i] <device_or_file>\n", argv[0]);
         return 1;
     }
-
-    const char *path = argv[1];
-    FILE *f = fopen(path, "rb");
-    if (!f) {
-        perror("fopen");
+    if (threads < 1) threads = 1;
+    if (threads > THREADS_MAX) threads = THREADS_MAX;
+    if (RAID_MIRRORS > MIRRORS_MAX) {
+        fprintf(stderr, "RAID_MIRRORS > %d not supported\n", MIRRORS_MAX);
         return 1;
     }
 
-    uint32_t total_sectors = detect_total_sectors(f);
-    if (!total_sectors) {
-        fprintf(stderr, "Failed to detect total sectors\n");
-        fclose(f);
+    const char *path = argv[optind];
+    uint8_t sector[STORAGE_BLOCK_MAX];
+    block_size = find_superblock(path, sector);
+    if (!block_size) {
+        fprintf(stderr, "No valid superblock copy at any block size\n");
         return 1;
     }
-    RAID_OFFSET = total_sectors / RAID_MIRRORS;
+    payload_size = block_size - HEADER_SIZE - CRC_SIZE;
 
-    printf(CLR_CYAN "\n=== Reader Configuration ===\n" CLR_RESET);
-    printf("File: %s\n", path);
-    printf("Sector size  : %u bytes\n", SECTOR_SIZE);
-    printf("Total sectors: %u\n", total_sectors);
-    printf("RAID mirrors : %u\n", RAID_MIRRORS);
-    printf("RAID offset  : %u\n\n", RAID_OFFSET);
+    scan_dev_t dev;
+    if (scan_open(&dev, path, block_size) != 0) {
+        perror("scan_open");
+        return 1;
+    }
 
-    uint8_t sector[SECTOR_SIZE];
+    uint64_t total_sectors = dev.total_sectors;
 
-    /* --- Read sector 0 --- */
-    if (read_bytes(f, sector, SECTOR_SIZE) != 0) {
-        fprintf(stderr, "Failed to read sector 0\n");
-        fclose(f);
-        return 1;
+    /* parity cards name their group in bytes 11..12, 0 there is mirrored */
+    if (sector[11]) {
+        if (sector[11] < 2 || sector[11] > EC_DATA_MAX || sector[12] < 1 || sector[12] > EC_PARITY_MAX) {
+            fprintf(stderr, "Unsupported parity group %u+%u\n", sector[11], sector[12]);
+            scan_close(&dev);
+            return 1;
+        }
+        ec_k = sector[11];
+        ec_m = sector[12];
+        slices = (uint32_t)ec_k + ec_m;
+        ec_init();   // before the -j workers rebuild from parity
     }
+    RAID_OFFSET = total_sectors / slices;
 
-    uint32_t last_sector = sector[0] | (sector[1] << 8) | (sector[2] << 16);
+    printf(CLR_CYAN "\n=== Reader Configuration ===\n" CLR_RESET);
+    printf("File: %s\n", path);
+    printf("Block size   : %u bytes (from superblock)\n", block_size);
+    printf("Total sectors: %" PRIu64 "\n", total_sectors);
+    printf("Access       : %s\n", dev.map ? "mmap" : "pread");
+    if (ec_k)
+        printf("RAID parity  : %u data + %u parity\n", ec_k, ec_m);
+    else
+        printf("RAID mirrors : %u\n", RAID_MIRRORS);
+    printf("RAID offset  : %" PRIu64 "\n", RAID_OFFSET);
+    printf("Threads      : %u\n\n", threads);
+
+    /* version 2 on: 64-bit tail at 16..23, older cards only have 0..2 */
+    uint8_t sb_version = sector[10];
+    last_sector = sb_tail(sector);
+    /* the last row (parity) or sector (mirrors) must lie inside the slice */
+    uint64_t slice_last = (ec_k && RAID_OFFSET > 2) ? 1 + (RAID_OFFSET - 2) * ec_k
+                                                    : RAID_OFFSET ? RAID_OFFSET - 1 : 0;
+    if (last_sector > slice_last) {
+        fprintf(stderr, CLR_RED "Tail %" PRIu64 " is past the slice, reading up to %" PRIu64 "\n" CLR_RESET,
+                last_sector, slice_last);
+        last_sector = slice_last;
+    }
     uint16_t last_msg = sector[3] | (sector[4] << 8);
     uint8_t is_first_full = sector[5];
 
     printf(CLR_MAG "=== Supersector Metadata ===\n" CLR_RESET);
-    printf("Last sector   : %u\n", last_sector);
-    printf("Last msg idx  : %u\n", last_msg);
-    printf("First log full: %u\n\n", is_first_full);
+    printf("Layout        : v%u (%s tail)\n", sb_version, sb_version >= 2 ? "64-bit" : "24-bit");
+    printf("Last sector   : %" PRIu64 "\n", last_sector);
+    printf("Messages      : %u\n", last_msg);
+    printf("Msg log full  : %u\n", is_first_full);
+
+    /* every worker streams each mirror sequentially through its own chunks */
+    worker_t *workers = calloc(threads, sizeof(worker_t));
+    pthread_t *tids = calloc(threads, sizeof(pthread_t));
+    if (!workers || !tids) {
+        perror("calloc");
+        scan_close(&dev);
+        return 1;
+    }
+    for (uint32_t t = 0; t < threads; t++) {
+        worker_t *w = &workers[t];
+        w->res = malloc(sizeof(sector_result_t) * CHUNK_SECTORS);
+        w->payload = malloc((size_t)CHUNK_SECTORS * payload_size);
+        if (!w->res || !w->payload) {
+            perror("malloc");
+            scan_close(&dev);
+            return 1;
+        }
+        /* parity slices hold rows, not logical sectors */
+        uint64_t end = (ec_k && last_sector >= 2) ? 2 + (last_sector - 2) / ec_k + 1 : last_sector + 1;
+        for (uint32_t m = 0; m < slices; m++) {
+            if (scan_stream_open(&w->streams[m], &dev, (uint64_t)m * RAID_OFFSET, end) != 0) {
+                perror("scan_stream_open");
+                scan_close(&dev);
+                return 1;
+            }
+        }
+    }
 
-    /* --- Open CSV files --- */
-    FILE *csv_payload = fopen(PATH_PAYLOAD, "w");
+    /* --- Resume after the checkpointed tail if it still matches --- */
+    uint64_t start = 2;
+    checkpoint_t cp;
+    if (incremental) {
+        const char *why = NULL;
+        if (load_checkpoint(PATH_CHECKPOINT, &cp) != 0)
+            why = "no checkpoint";
+        else if (fmt == EXPORT_COL)
+            why = "col exports cannot be appended";
+        else if (strcmp(cp.format, format_name) != 0 || cp.sector_size != block_size ||
+                 cp.total_sectors != total_sectors)
+            why = "checkpoint is for another format or device";
+        else if (cp.last_exported < 2 || cp.last_exported > last_sector)
+            why = "log is shorter than the checkpoint";
+        else if (tail_crc(&workers[0], cp.last_exported) != cp.tail_crc)
+            why = "tail changed";
+
+        if (why) {
+            printf("Incremental   : full rescan (%s)\n", why);
+        } else {
+            start = cp.last_exported + 1;
+            printf("Incremental   : resuming after sector %" PRIu64 "\n", cp.last_exported);
+        }
+    }
+
+    /* --- Open output files --- */
+    exporter_t out;
+    records_t recs;
+    samples_t smp;
     FILE *csv_meta = fopen(PATH_METADATA, "w");
-    if (!csv_payload || !csv_meta) {
-        perror("fopen CSV");
-        fclose(f);
+    unpacked.payload = malloc((size_t)RLE_RECORDS_MAX * payload_size);
+    if (!csv_meta || !unpacked.payload ||
+        export_open(&out, fmt, payload_path, block_size, payload_size, start, start > 2) != 0 ||
+        records_open(&recs, PATH_RECORDS, start > 2) != 0 ||
+        samples_open(&smp, PATH_SAMPLES, start > 2) != 0) {
+        perror("fopen output");
+        scan_close(&dev);
         return 1;
     }
 
-    fprintf(csv_payload, "status,header,payload(hex...),crc_stored,crc_calc\n");
+    /* re-assemble the packed record the last run stopped in the middle of */
+    if (start > 2 && cp.pack_sector >= 2 && cp.pack_sector < start) {
+        worker_t *w = &workers[0];
+        uint32_t ok = w->ok, bad = w->bad, rebuilt = w->rebuilt;
+        records_resume(&recs, cp.pack_sector, (uint16_t)cp.pack_offset, start);
+        for (uint64_t s = cp.pack_sector; s < start; s += w->count) {
+            w->first = s;
+            w->count = (start - s < CHUNK_SECTORS) ? (uint32_t)(start - s) : CHUNK_SECTORS;
+            verify_range(w);
+            decode_range(&recs, w);
+        }
+        w->ok = ok;
+        w->bad = bad;
+        w->rebuilt = rebuilt;
+    }
+
     fprintf(csv_meta, "type,last_sector,last_msg,is_first_full,raw(hex...)\n");
 
     /* --- Sector 0 raw metadata --- */
-    fprintf(csv_meta, "sector0,%u,%u,%u,\"", last_sector, last_msg, is_first_full);
-    for (int i = 0; i < SECTOR_SIZE; i++)
+    fprintf(csv_meta, "sector0,%" PRIu64 ",%u,%u,\"", last_sector, last_msg, is_first_full);
+    for (uint32_t i = 0; i < block_size; i++)
         fprintf(csv_meta, "%02x ", sector[i]);
     fprintf(csv_meta, "\"\n");
 
-    printf(CLR_MAG "=== Reading RAID Sectors ===\n" CLR_RESET);
-
-    uint32_t ok_total = 0, bad_total = 0;
+    /* --- Sector 1: message log, first mirror with a valid CRC --- */
+    int msg_ok = 0;
+    for (uint32_t m = 0; m < slices && !msg_ok; m++) {
+        if (scan_read(&dev, SUPER_SECTOR_2 + m * RAID_OFFSET, 1, sector) != 0) continue;
+        uint32_t stored = sector[block_size - 4] | (sector[block_size - 3] << 8) |
+                          (sector[block_size - 2] << 16) | ((uint32_t)sector[block_size - 1] << 24);
+        msg_ok = (stored == crc32(sector, block_size - CRC_SIZE));
+    }
+    if (last_msg > block_size - CRC_SIZE) last_msg = block_size - CRC_SIZE;
+    printf("Msg log CRC   : %s\n\n", msg_ok ? "OK" : "BAD");
+    fprintf(csv_meta, "msglog,%" PRIu64 ",%u,%u,\"", last_sector, last_msg, is_first_full);
+    for (uint32_t i = 0; i < last_msg; i++)
+        fprintf(csv_meta, "%02x ", msg_ok ? sector[i] : 0);
+    fprintf(csv_meta, "\"\n");
 
-    for (uint32_t logical = 2; logical <= last_sector; logical++) {
-        uint32_t stored_crc[RAID_MIRRORS];
-        uint32_t calc_crc[RAID_MIRRORS];
-        int crc_ok[RAID_MIRRORS];
-        uint8_t headers[RAID_MIRRORS];
-        uint8_t payloads[RAID_MIRRORS][PAYLOAD_SIZE];
+    printf(CLR_MAG "=== Reading RAID Sectors ===\n" CLR_RESET);
 
-        printf(CLR_YELLOW "\nLogical sector %u\n" CLR_RESET, logical);
-        printf("------------------------------------------------------------\n");
+    uint32_t ok_total = 0, bad_total = 0, rebuilt_total = 0;
+
+    /* rounds of one chunk per worker; results are emitted in chunk order */
+    uint64_t next = start;
+    int export_ok = 1;
+    while (next <= last_sector && export_ok) {
+        uint32_t used = 0;
+        for (; used < threads && next <= last_sector; used++) {
+            worker_t *w = &workers[used];
+            w->first = next;
+            w->count = (last_sector - next + 1 < CHUNK_SECTORS) ? (uint32_t)(last_sector - next + 1)
+                                                                : CHUNK_SECTORS;
+            next += w->count;
+        }
 
-        for (int m = 0; m < RAID_MIRRORS; m++) {
-            uint32_t physical = logical + m * RAID_OFFSET;
+        if (used == 1) {
+            verify_range(&workers[0]);
+        } else {
+            uint32_t started = 0;
+            for (; started < used; started++)
+                if (pthread_create(&tids[started], NULL, verify_range, &workers[started]) != 0)
+                    break;
+            for (uint32_t t = started; t < used; t++)
+                verify_range(&workers[t]);   // could not spawn, run inline
+            for (uint32_t t = 0; t < started; t++)
+                pthread_join(tids[t], NULL);
+        }
 
-            if (fseek(f, (long)physical * SECTOR_SIZE, SEEK_SET) != 0 ||
-                read_bytes(f, sector, SECTOR_SIZE) != 0) {
-                fprintf(stderr, CLR_RED "Read failed for sector %u (mirror %d)\n" CLR_RESET,
-                        physical, m);
-                crc_ok[m] = 0;
-                continue;
+        for (uint32_t t = 0; t < used; t++) {
+            if (!quiet) print_range(&workers[t]);
+            if (export_range(&out, &workers[t]) != 0) {
+                perror("export");
+                export_ok = 0;
+                break;
             }
-
-            headers[m] = sector[0];
-            memcpy(payloads[m], &sector[1], PAYLOAD_SIZE);
-
-            stored_crc[m] = sector[508] |
-                            (sector[509] << 8) |
-                            (sector[510] << 16) |
-                            (sector[511] << 24);
-
-            calc_crc[m] = crc32_u8bit(sector, HEADER_SIZE + PAYLOAD_SIZE);
-            crc_ok[m] = (stored_crc[m] == calc_crc[m]);
-
-            printf(" Mirror %d @ sector %-8u  Header: 0x%02X  Stored CRC: 0x%08X  Calc CRC: 0x%08X  [%s]\n",
-                   m, physical, headers[m], stored_crc[m], calc_crc[m],
-                   crc_ok[m] ? (CLR_GREEN "OK" CLR_RESET) : (CLR_RED "BAD" CLR_RESET));
+            decode_range(&recs, &workers[t]);
+            sample_range(&smp, &workers[t]);
         }
+    }
 
-        /* --- Decide which mirror to trust --- */
-        int chosen = -1;
-        for (int m = 0; m < RAID_MIRRORS; m++)
-            if (crc_ok[m]) { chosen = m; break; }
-
-        const char *status = (chosen >= 0) ? "CRC_OK" : "CRC_FAIL";
-        int use = (chosen >= 0) ? chosen : 0;
-
-        if (chosen >= 0) ok_total++;
-        else bad_total++;
-
-        printf(" -> Result: %s (using mirror %d)\n",
-               (chosen >= 0) ? (CLR_GREEN "VALID" CLR_RESET) : (CLR_RED "CORRUPTED" CLR_RESET),
-               use);
+    /* a failed export must not be resumed from */
+    if (export_ok && last_sector >= 2) {
+        checkpoint_t now = {
+            .sector_size = block_size,
+            .total_sectors = total_sectors,
+            .last_exported = last_sector,
+            .tail_crc = tail_crc(&workers[0], last_sector)
+        };
+        uint16_t off = 0;
+        now.pack_sector = records_open_sector(&recs, &off);
+        now.pack_offset = off;
+        snprintf(now.format, sizeof(now.format), "%s", format_name);
+        if (save_checkpoint(PATH_CHECKPOINT, &now) != 0) perror("checkpoint");
+    }
 
-        /* --- Save to CSV --- */
-        fprintf(csv_payload, "%s,%u,\"", status, headers[use]);
-        for (int i = 0; i < PAYLOAD_SIZE; i++)
-            fprintf(csv_payload, "%02x ", payloads[use][i]);
-        fprintf(csv_payload, "\",%u,%u\n", stored_crc[use], calc_crc[use]);
+    for (uint32_t t = 0; t < threads; t++) {
+        ok_total += workers[t].ok;
+        bad_total += workers[t].bad;
+        rebuilt_total += workers[t].rebuilt;
+        for (uint32_t m = 0; m < slices; m++)
+            scan_stream_close(&workers[t].streams[m]);
+        free(workers[t].res);
+        free(workers[t].payload);
     }
+    free(workers);
+    free(tids);
 
     printf(CLR_CYAN "\n=== RAID Integrity Summary ===\n" CLR_RESET);
     printf("Valid sectors  : %u\n", ok_total);
     printf("Corrupted sect : %u\n", bad_total);
-    printf("Mirrors used   : %u\n", RAID_MIRRORS);
-    printf("RAID offset    : %u\n", RAID_OFFSET);
-    printf("Output files   : %s, %s\n\n", PATH_PAYLOAD, PATH_METADATA);
+    if (ec_k) printf("Rebuilt sect   : %u (from parity)\n", rebuilt_total);
+    printf("Packed records : %lu (%lu dropped)\n",
+           (unsigned long)recs.records, (unsigned long)recs.dropped);
+    printf("Sample frames  : %lu (%lu sectors dropped)\n",
+           (unsigned long)smp.frames, (unsigned long)smp.dropped);
+    printf("Profile        : %s\n", STORAGE_PROFILE_NAME);
+    if (ec_k)
+        printf("Parity group   : %u+%u\n", ec_k, ec_m);
+    else
+        printf("Mirrors used   : %u\n", RAID_MIRRORS);
+    printf("RAID offset    : %" PRIu64 "\n", RAID_OFFSET);
+    printf("Output files   : %s, %s, %s, %s\n\n", payload_path, PATH_RECORDS, PATH_SAMPLES,
+           PATH_METADATA);
 
     fclose(csv_meta);
-    fclose(csv_payload);
-    fclose(f);
+    if (export_close(&out) != 0) perror("export");
+    free(unpacked.payload);
+    if (records_close(&recs) != 0) perror("records");
+    if (samples_close(&smp) != 0) perror("samples");
+    scan_close(&dev);
     return 0;
 }
@@ -0,0 +1,135 @@
+#define _GNU_SOURCE
+#include "scan.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+
+int scan_open(scan_dev_t *dev, const char *path, uint32_t sector_size) {
+    struct stat st;
+
+    dev->fd = open(path, O_RDONLY);
+    dev->map = NULL;
+    dev->sector_size = sector_size;
+    if (dev->fd < 0) return -1;
+    if (fstat(dev->fd, &st) != 0) goto fail;
+
+    if (S_ISBLK(st.st_mode)) {
+        uint64_t bytes = 0;
+        if (ioctl(dev->fd, BLKGETSIZE64, &bytes) != 0) goto fail;
+        dev->size_bytes = bytes;
+        posix_fadvise(dev->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    } else {
+        dev->size_bytes = (uint64_t)st.st_size;
+        if (dev->size_bytes) {
+            void *p = mmap(NULL, dev->size_bytes, PROT_READ, MAP_SHARED, dev->fd, 0);
+            if (p != MAP_FAILED) {
+                dev->map = p;
+                madvise(p, dev->size_bytes, MADV_SEQUENTIAL);
+            } else {
+                posix_fadvise(dev->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            }
+        }
+    }
+
+    dev->total_sectors = dev->size_bytes / sector_size;
+    if (dev->total_sectors == 0) {
+        errno = EINVAL;
+        goto fail;
+    }
+    return 0;
+
+fail:
+    scan_close(dev);
+    return -1;
+}
+
+void scan_close(scan_dev_t *dev) {
+    if (dev->map) munmap((void *)dev->map, dev->size_bytes);
+    if (dev->fd >= 0) close(dev->fd);
+    dev->map = NULL;
+    dev->fd = -1;
+}
+
+int scan_read(scan_dev_t *dev, uint64_t first, uint32_t n, uint8_t *buf) {
+    if (first + n > dev->total_sectors) return -1;
+
+    size_t len = (size_t)n * dev->sector_size;
+    off_t offset = (off_t)(first * dev->sector_size);
+    if (dev->map) {
+        memcpy(buf, dev->map + offset, len);
+        return 0;
+    }
+    while (len) {
+        ssize_t rc = pread(dev->fd, buf, len, offset);
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) return -1;
+        buf += rc;
+        len -= (size_t)rc;
+        offset += rc;
+    }
+    return 0;
+}
+
+int scan_stream_open(scan_stream_t *s, scan_dev_t *dev, uint64_t base, uint64_t end) {
+    s->dev = dev;
+    s->base = base;
+    s->first = s->len = 0;
+    s->end = end;
+    s->slow_until = 0;
+    s->buf = NULL;
+    s->one = malloc(dev->sector_size);
+    if (!s->one) return -1;
+    if (!dev->map) {
+        s->buf = malloc((size_t)SCAN_WINDOW * dev->sector_size);
+        if (!s->buf) {
+            free(s->one);
+            s->one = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void scan_stream_close(scan_stream_t *s) {
+    free(s->buf);
+    free(s->one);
+    s->buf = s->one = NULL;
+}
+
+const uint8_t *scan_stream_get(scan_stream_t *s, uint64_t logical) {
+    scan_dev_t *dev = s->dev;
+    uint64_t physical = s->base + logical;
+
+    if (physical >= dev->total_sectors) return NULL;
+    if (dev->map) return dev->map + physical * dev->sector_size;
+
+    if (logical >= s->first && logical < s->first + s->len)
+        return s->buf + (logical - s->first) * dev->sector_size;
+
+    if (logical < s->slow_until)
+        return scan_read(dev, physical, 1, s->one) == 0 ? s->one : NULL;
+
+    /* refill the window starting here, clipped to the stream and device */
+    uint64_t n = SCAN_WINDOW;
+    if (s->end > logical && s->end - logical < n) n = s->end - logical;
+    if (dev->total_sectors - physical < n) n = dev->total_sectors - physical;
+    if (n == 0) n = 1;
+
+    if (scan_read(dev, physical, (uint32_t)n, s->buf) == 0) {
+        s->first = logical;
+        s->len = n;
+        return s->buf;
+    }
+
+    /* go sector by sector across the window that failed */
+    s->len = 0;
+    s->slow_until = logical + n;
+    return scan_read(dev, physical, 1, s->one) == 0 ? s->one : NULL;
+}
@@ -0,0 +1,57 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Read-only scanning layer for the reader tools.
+ *
+ * Regular image files are mmapped and handed out in place. Block devices
+ * are read with large sequential preads instead: a media error there is
+ * an EIO we can recover from, while on a mapping it would be a SIGBUS.
+ */
+
+/* Sectors fetched per stream refill on the pread path (1 MB at 512 B) */
+#ifndef SCAN_WINDOW
+#define SCAN_WINDOW 2048
+#endif
+
+typedef struct {
+    int fd;
+    uint32_t sector_size;
+    uint64_t size_bytes;
+    uint64_t total_sectors;
+    const uint8_t *map;     // whole image when mmapped, else NULL
+} scan_dev_t;
+
+/* Sequential cursor over one region of the device, e.g. one mirror */
+typedef struct {
+    scan_dev_t *dev;
+    uint64_t base;          // physical sector of logical sector 0
+    uint64_t first, len;    // logical sectors currently held in buf
+    uint64_t end;           // logical sectors past this are never prefetched
+    uint64_t slow_until;    // single-sector reads below this (failed window)
+    uint8_t *buf;           // SCAN_WINDOW sectors, pread path only
+    uint8_t *one;           // single-sector fallback buffer
+} scan_stream_t;
+
+/* Returns 0 on success, -1 with errno set otherwise */
+int scan_open(scan_dev_t *dev, const char *path, uint32_t sector_size);
+void scan_close(scan_dev_t *dev);
+
+/* Copy n sectors starting at physical sector first */
+int scan_read(scan_dev_t *dev, uint64_t first, uint32_t n, uint8_t *buf);
+
+int scan_stream_open(scan_stream_t *s, scan_dev_t *dev, uint64_t base, uint64_t end);
+void scan_stream_close(scan_stream_t *s);
+
+/*
+ * Pointer to logical sector `logical` of the stream, valid until the next
+ * call on the same stream, or NULL if it cannot be read. Ascending access
+ * is served from the window; a failed window falls back to the single
+ * sector so one bad block does not hide its neighbours.
+ */
+const uint8_t *scan_stream_get(scan_stream_t *s, uint64_t logical);
+
+#endif /* SCAN_H */
@@ -1,24 +1,721 @@
 #include "driver.h"
+#include "ram_driver.h"
+#include "multi_driver.h"
 #include "storage.h"
+#include "config.h"
+#include "codec.h"
+#include "columns.h"
+#include "crc32.h"
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
-extern driver_t linux_driver;
-driver_t *active_driver = &linux_driver;
+driver_t *active_driver = &ram_driver;
 uint32_t log_sector = 0;  // global required by storage.c
 uint8_t status;
 
 uint8_t test_save_msg(void) {
   uint8_t err;
   uint8_t msg = 5;
+  uint32_t saved = 0;
   for (uint32_t i = 0; i < 1024; i++) {
     err = save_msg(&msg);
+    if (err == STORAGE_ERR_LOG_FULL)
+      break;
     if (err != STORAGE_OK)
       return err;
+    saved++;
   }
+  // one sector of messages, flushed automatically when it filled up
+  if (saved != SECTOR_SIZE - CRC_SIZE)
+    return STORAGE_ERR_LOG_FULL;
+  return msg_flush();
+}
+
+// Logical sectors 2 and 3 hold 507 x 12 (0xAB) and 507 x 6 (0xBC)
+uint8_t test_read_values(void) {
+  uint8_t out[2 * 507];
+  uint8_t headers[2];
+  uint8_t garbage[512];
+  uint8_t err;
+
+  err = read_u8bit_values(2, 2, out, headers);
+  if (err != STORAGE_OK)
+    return err;
+  if (headers[0] != 0xAB || headers[1] != 0xBC || out[0] != 12 || out[507] != 6)
+    return STORAGE_ERR_CORRUPT;
+  if (read_u8bit_values(3, 2, out, headers) != STORAGE_ERR_PARAM)
+    return STORAGE_ERR_PARAM;
+
+  // corrupt logical 2 on mirror 0: the fast path falls back and blames it
+  memset(garbage, 0x5A, sizeof(garbage));
+  if (active_driver->write_block(active_driver, 2, garbage) != DRIVER_OK)
+    return STORAGE_ERR_DRIVER;
+  err = read_u8bit_values(2, 1, out, headers);
+  if (err != STORAGE_OK)
+    return err;
+  if (headers[0] != 0xAB || out[506] != 12 || storage_mirror_errors(0) != 1)
+    return STORAGE_ERR_CORRUPT;
+
+  // mirror 0 now has the most errors, so it is no longer read first
+  err = read_u8bit_values(2, 1, out, headers);
+  if (err != STORAGE_OK || storage_mirror_errors(0) != 1)
+    return STORAGE_ERR_CORRUPT;
+
+  storage_set_read_mode(STORAGE_READ_VOTE);
+  err = read_u8bit_values(2, 2, out, headers);
+  storage_set_read_mode(STORAGE_READ_FAST);
+  if (err != STORAGE_OK)
+    return err;
+  if (headers[0] != 0xAB || out[0] != 12 || out[507] != 6)
+    return STORAGE_ERR_CORRUPT;
+  return STORAGE_OK;
+}
+
+// Runs after test_read_values(), which left logical 2 corrupt on mirror 0
+uint8_t test_scrub(void) {
+  storage_scrub_stats_t st;
+  uint8_t garbage[512];
+  uint8_t a[512], b[512];
+  uint8_t err;
+
+  memset(garbage, 0xA5, sizeof(garbage));
+  if (active_driver->write_block(active_driver, 3 + RAID_OFFSET, garbage) != DRIVER_OK)
+    return STORAGE_ERR_DRIVER;
+
+  // a budget of one logical sector checks exactly one
+  err = storage_scrub_step(RAID_MIRRORS);
+  if (err != STORAGE_OK)
+    return err;
+  storage_scrub_stats(&st);
+  if (st.checked != 1 || st.cursor != 3)
+    return STORAGE_ERR_CORRUPT;
+
+  err = storage_scrub_step(100);
+  if (err != STORAGE_OK)
+    return err;
+  storage_scrub_stats(&st);
+  if (st.checked != 2 || st.repaired != 2 || st.passes != 1 || st.unrecoverable)
+    return STORAGE_ERR_CORRUPT;
+
+  // both bad copies were rewritten from the good ones
+  for (uint32_t logical = 2; logical <= 3; logical++) {
+    for (uint32_t m = 1; m < RAID_MIRRORS; m++) {
+      active_driver->read_block(active_driver, logical, a);
+      active_driver->read_block(active_driver, logical + m * RAID_OFFSET, b);
+      if (memcmp(a, b, sizeof(a)) != 0)
+        return STORAGE_ERR_CORRUPT;
+    }
+  }
+
+  // the reads use up the budget, the repair still finishes and the cursor moves on
+  active_driver->write_block(active_driver, 2 + RAID_OFFSET, garbage);
+  if ((err = storage_scrub_step(RAID_MIRRORS)) != STORAGE_OK)
+    return err;
+  storage_scrub_stats(&st);
+  active_driver->read_block(active_driver, 2, a);
+  active_driver->read_block(active_driver, 2 + RAID_OFFSET, b);
+  if (st.checked != 3 || st.repaired != 3 || st.cursor != 3 || memcmp(a, b, sizeof(a)) != 0)
+    return STORAGE_ERR_CORRUPT;
+  return STORAGE_OK;
+}
+
+// Appends logical sectors 4..6 through the zero-copy path
+uint8_t test_reserve_commit(void) {
+  storage_reservation_t resv;
+  uint8_t header = 0xCD;
+  uint8_t out[3 * 507];
+  uint8_t headers[3];
+  uint8_t err;
+
+  err = storage_reserve(3, &resv);
+  if (err != STORAGE_OK)
+    return err;
+  if (storage_reserve(1, &resv) != STORAGE_ERR_PARAM)  // one at a time
+    return STORAGE_ERR_PARAM;
+  for (uint32_t i = 0; i < resv.count; i++)
+    memset(resv.payload + i * resv.stride, 0x40 + i, 507);
+
+  err = storage_commit(&header);
+  if (err != STORAGE_OK)
+    return err;
+
+  err = read_u8bit_values(4, 3, out, headers);
+  if (err != STORAGE_OK)
+    return err;
+  for (uint32_t i = 0; i < 3; i++)
+    if (headers[i] != 0xCD || out[i * 507] != 0x40 + i || out[i * 507 + 506] != 0x40 + i)
+      return STORAGE_ERR_CORRUPT;
+  return STORAGE_OK;
+}
+
+// Packs 20 + 600 + 40 byte records into logical sectors 7 and 8
+uint8_t test_pack_records(void) {
+  uint8_t rec[600];
+  uint8_t out[2 * 507];
+  uint8_t headers[2];
+  uint8_t header = STORAGE_SECTOR_PACKED;
+  uint8_t err;
+
+  if (raid_u8bit_values(rec, 507, &header) != STORAGE_ERR_PARAM)  // reserved type
+    return STORAGE_ERR_PARAM;
+
+  memset(rec, 0x11, sizeof(rec));
+  if ((err = storage_pack_record(1, rec, 20)) != STORAGE_OK)
+    return err;
+  if ((err = storage_pack_record(2, rec, 600)) != STORAGE_OK)
+    return err;
+  if ((err = storage_pack_record(3, rec, 40)) != STORAGE_OK)
+    return err;
+  if ((err = storage_flush()) != STORAGE_OK)
+    return err;
+
+  err = read_u8bit_values(7, 2, out, headers);
+  if (err != STORAGE_OK)
+    return err;
+  if (headers[0] != STORAGE_SECTOR_PACKED || headers[1] != STORAGE_SECTOR_PACKED)
+    return STORAGE_ERR_CORRUPT;
+
+  // sector 7 starts with record 1; sector 8 continues record 2, record 3 at 121
+  uint16_t first7 = out[0] | (out[1] << 8);
+  uint16_t first8 = out[507] | (out[508] << 8);
+  if (first7 != 0 || out[2] != 1 || out[3] != 20 || out[2 + 23] != 2)
+    return STORAGE_ERR_CORRUPT;
+  if (first8 != 121 || out[507 + 2 + 121] != 3 || out[507 + 2 + 124 + 40] != STORAGE_PACK_PAD)
+    return STORAGE_ERR_CORRUPT;
+  return STORAGE_OK;
+}
+
+uint8_t test_compress(void) {
+  uint8_t rec[3 * 507];
+  uint8_t out[2 * 507];
+  uint8_t dec[4 * 507];
+  uint8_t headers[2];
+  uint8_t header = 0x42;
+  uint8_t user;
+  uint32_t x = 1;
+  uint8_t err;
+
+  for (size_t i = 0; i < 507; i++) {
+    rec[i] = 12;                     // one run
+    rec[507 + i] = (uint8_t)(i * 3); // a run once delta filtered
+    x = x * 1103515245u + 12345u;
+    rec[1014 + i] = (uint8_t)(x >> 16); // does not compress
+  }
+
+  storage_set_compression(STORAGE_COMPRESS_RLE);
+  err = raid_u8bit_values(rec, sizeof(rec), &header);
+  storage_set_compression(STORAGE_COMPRESS_OFF);
+  if (err != STORAGE_OK)
+    return err;
+  if ((err = storage_flush()) != STORAGE_OK)
+    return err;
+
+  // sector 9 shares the first two records, the noise stays a plain sector 10
+  err = read_u8bit_values(9, 2, out, headers);
+  if (err != STORAGE_OK)
+    return err;
+  if (headers[0] != STORAGE_SECTOR_RLE || headers[1] != header)
+    return STORAGE_ERR_CORRUPT;
+  if (codec_sector_decode(out, 507, 507, dec, 4, &user) != 2 || user != header)
+    return STORAGE_ERR_CORRUPT;
+  if (memcmp(dec, rec, 2 * 507) != 0 || memcmp(&out[507], &rec[1014], 507) != 0)
+    return STORAGE_ERR_CORRUPT;
+  if (read_u8bit_values(11, 1, out, headers) != STORAGE_ERR_PARAM)  // nothing past the tail
+    return STORAGE_ERR_PARAM;
+
+  // or decoded: three records with the user header, from two sectors
+  uint8_t users[4];
+  uint32_t n = 0;
+  if (read_u8bit_records(9, 2, dec, 2, users, &n) != STORAGE_ERR_FULL)
+    return STORAGE_ERR_FULL;
+  if (read_u8bit_records(9, 2, dec, 4, users, &n) != STORAGE_OK || n != 3 ||
+      memcmp(dec, rec, sizeof(rec)) != 0)
+    return STORAGE_ERR_CORRUPT;
+  for (uint32_t i = 0; i < n; i++)
+    if (users[i] != header)
+      return STORAGE_ERR_CORRUPT;
+  return STORAGE_OK;
+}
+
+uint8_t test_columns(void) {
+  static int16_t samples[600 * 2];
+  static int32_t values[COLUMNS_FRAMES_MAX * 2];
+  uint8_t out[8 * 507];
+  uint8_t headers[8];
+  uint8_t header = 0x21;
+  uint8_t type, channels, user;
+  uint32_t frames = 0;
+  uint8_t err;
+
+  for (int f = 0; f < 600; f++) {
+    samples[2 * f] = (int16_t)(f * 5 - 1000);       // ramp, deltas are constant
+    samples[2 * f + 1] = (int16_t)((f * f) % 4001); // wraps, needs wide residuals
+  }
+  if (save_16bit_values(samples, 600, COLUMNS_CHANNELS_MAX + 1, &header) != STORAGE_ERR_PARAM)
+    return STORAGE_ERR_PARAM;
+  if ((err = save_16bit_values(samples, 600, 2, &header)) != STORAGE_OK)
+    return err;
+  if ((err = storage_flush()) != STORAGE_OK)
+    return err;
+
+  // 2400 raw bytes would take 5 sectors; columns start after the compression test
+  uint32_t n = 0;
+  while (n < 8 && read_u8bit_values(11 + n, 1, &out[n * 507], &headers[n]) == STORAGE_OK)
+    n++;
+  if (n == 0 || n >= 5)
+    return STORAGE_ERR_CORRUPT;
+
+  for (uint32_t s = 0; s < n; s++) {
+    if (headers[s] != STORAGE_SECTOR_COLUMNS)
+      return STORAGE_ERR_CORRUPT;
+    int k = columns_decode(&out[s * 507], 507, values, COLUMNS_FRAMES_MAX * 2, &type, &channels,
+                           &user);
+    if (k <= 0 || type != (2 | COLUMNS_SIGNED) || channels != 2 || user != header)
+      return STORAGE_ERR_CORRUPT;
+    for (int f = 0; f < k; f++)
+      if (values[f] != samples[2 * (frames + f)] || values[k + f] != samples[2 * (frames + f) + 1])
+        return STORAGE_ERR_CORRUPT;
+    frames += (uint32_t)k;
+  }
+  return frames == 600 ? STORAGE_OK : STORAGE_ERR_CORRUPT;
+}
+
+// Every decode kernel level against the encoder's input: random walks,
+// curves and noise in 16 and 32 bits, so each mode and bit width shows up
+uint8_t test_columns_kernels(void) {
+  static uint32_t in[COLUMNS_FRAMES_MAX * 4];
+  static int32_t out[COLUMNS_FRAMES_MAX * 4];
+  uint8_t sector[507];
+  uint32_t seed = 12345;
+
+  for (int round = 0; round < 3000; round++) {
+    uint8_t type = (round & 1) ? 4 : (2 | COLUMNS_SIGNED);
+    uint8_t channels = (uint8_t)(1 + round % 4);
+    uint32_t frames = 1 + (uint32_t)(round * 7) % 300;
+    uint32_t shift = (uint32_t)round % 31;
+    for (uint32_t f = 0; f < frames; f++) {
+      for (uint8_t c = 0; c < channels; c++) {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t noise = seed >> (1 + shift);
+        uint32_t v;
+        switch ((round + c) % 3) {
+        case 0: v = (f ? in[(f - 1) * channels + c] : 0) + noise - (noise >> 1); break;
+        case 1: v = f * f * (c + 1) + (noise & 3); break;
+        default: v = seed ^ (seed << shift); break;
+        }
+        if (type != 4) v = (uint32_t)(int32_t)(int16_t)v;
+        in[f * channels + c] = v;
+      }
+    }
+    uint16_t in16[COLUMNS_FRAMES_MAX * 4];
+    const void *buf = in;
+    if (type != 4) {
+      for (uint32_t i = 0; i < frames * channels; i++) in16[i] = (uint16_t)in[i];
+      buf = in16;
+    }
+    uint32_t n = columns_fit(buf, type, frames, channels, 0, sizeof(sector));
+    columns_encode(buf, type, channels, 0, n, 0x21, sector, sizeof(sector));
+    for (uint8_t level = 0; level <= 2; level++) {
+      columns_set_simd(level);
+      if (columns_decode(sector, sizeof(sector), out, COLUMNS_FRAMES_MAX * 4, NULL, NULL, NULL) != (int)n)
+        return STORAGE_ERR_CORRUPT;
+      for (uint32_t f = 0; f < n; f++)
+        for (uint8_t c = 0; c < channels; c++)
+          if ((uint32_t)out[c * n + f] != in[f * channels + c])
+            return STORAGE_ERR_CORRUPT;
+    }
+  }
+  columns_set_simd(2);
   return STORAGE_OK;
 }
 
+// The superblock names the block size; a card with other blocks is refused
+uint8_t test_block_size(void) {
+  uint8_t sb[512], forged[512];
+
+  if (active_driver->read_block(active_driver, 0, sb) != DRIVER_OK)
+    return STORAGE_ERR_DRIVER;
+  if (sb[9] != 9)
+    return STORAGE_ERR_META;
+
+  memcpy(forged, sb, sizeof(sb));
+  forged[9] = 12;
+  uint32_t crc = crc32(forged, 508);
+  for (int k = 0; k < 4; k++)
+    forged[508 + k] = (uint8_t)(crc >> (8 * k));
+  for (uint32_t m = 0; m < RAID_MIRRORS; m++)
+    active_driver->write_block(active_driver, m * RAID_OFFSET, forged);
+  uint8_t refused = storage_revalidate() == STORAGE_ERR_META;
+
+  for (uint32_t m = 0; m < RAID_MIRRORS; m++)
+    active_driver->write_block(active_driver, m * RAID_OFFSET, sb);
+  if (!refused)
+    return STORAGE_ERR_PARAM;
+  return storage_revalidate();
+}
+
+static void put_superblock(uint8_t *sb) {
+  uint32_t crc = crc32(sb, 508);
+  for (int k = 0; k < 4; k++)
+    sb[508 + k] = (uint8_t)(crc >> (8 * k));
+  for (uint32_t m = 0; m < RAID_MIRRORS; m++)
+    active_driver->write_block(active_driver, m * RAID_OFFSET, sb);
+}
+
+static uint64_t sb_tail64(const uint8_t *sb) {
+  uint64_t v = 0;
+  for (int k = 7; k >= 0; k--)
+    v = (v << 8) | sb[16 + k];
+  return v;
+}
+
+// 24-bit cards still load and are upgraded; the 64-bit tail is what counts
+uint8_t test_wide_tail(void) {
+  uint8_t sb[512], forged[512], out[507];
+  uint8_t header = 0x11;
+
+  if (active_driver->read_block(active_driver, 0, sb) != DRIVER_OK)
+    return STORAGE_ERR_DRIVER;
+  uint64_t tail = sb_tail64(sb);
+  if (sb[10] != 2 || tail != (uint64_t)(sb[0] | (sb[1] << 8) | (sb[2] << 16)))
+    return STORAGE_ERR_META;
+
+  // a card from before the 64-bit fields: version 0, bytes 10.. zero
+  memcpy(forged, sb, sizeof(sb));
+  memset(forged + 10, 0, 22);
+  put_superblock(forged);
+  if (storage_revalidate() != STORAGE_OK || read_u8bit_values(tail, 1, out, NULL) != STORAGE_OK)
+    return STORAGE_ERR_META;
+  memset(out, 7, sizeof(out));
+  if (raid_u8bit_values(out, sizeof(out), &header) != STORAGE_OK || storage_flush() != STORAGE_OK)
+    return STORAGE_ERR_DRIVER;
+  if (active_driver->read_block(active_driver, 0, sb) != DRIVER_OK)
+    return STORAGE_ERR_DRIVER;
+  if (sb[10] != 2 || sb_tail64(sb) != tail + 1)
+    return STORAGE_ERR_META;
+
+  // a tail past 24 bits: the card reads as full, not as 5 sectors long
+  memcpy(forged, sb, sizeof(sb));
+  forged[0] = forged[1] = forged[2] = 0xFF;
+  forged[16] = 5;
+  forged[20] = 1;
+  put_superblock(forged);
+  uint8_t full = storage_revalidate() == STORAGE_OK &&
+                 raid_u8bit_values(out, sizeof(out), &header) == STORAGE_ERR_FULL;
+
+  forged[10] = 3;   // newer layout than this build
+  put_superblock(forged);
+  uint8_t refused = storage_revalidate() == STORAGE_ERR_META;
+
+  put_superblock(sb);
+  if (!full || !refused)
+    return STORAGE_ERR_PARAM;
+  return storage_revalidate();
+}
+
+// 4 + 2 parity rows: logical 2 + 4r + c is column c of row 2 + r
+uint8_t test_erasure(void) {
+  static uint8_t data[12 * 507], out[12 * 507];
+  uint8_t garbage[512];
+  uint8_t header = 0x21;
+
+  if (storage_set_redundancy(4, 3) != STORAGE_ERR_PARAM ||
+      storage_set_redundancy(4, 2) != STORAGE_OK || init_log_sector() != STORAGE_OK)
+    return STORAGE_ERR_PARAM;
+  if (RAID_OFFSET != active_driver->total_sectors / 6)
+    return STORAGE_ERR_META;
+
+  for (size_t b = 0; b < sizeof(data); b++)
+    data[b] = (uint8_t)(b / 507 * 31 + b);
+  if (raid_u8bit_values(data, 10 * 507, &header) != STORAGE_OK)
+    return STORAGE_ERR_DRIVER;
+
+  // two data columns of row 2, then P of row 3 with one of its columns,
+  // then the half-written tail row 4
+  memset(garbage, 0x5A, sizeof(garbage));
+  active_driver->write_block(active_driver, 2, garbage);
+  active_driver->write_block(active_driver, 2 + 2 * RAID_OFFSET, garbage);
+  active_driver->write_block(active_driver, 3 + 4 * RAID_OFFSET, garbage);
+  active_driver->write_block(active_driver, 3 + 1 * RAID_OFFSET, garbage);
+  active_driver->write_block(active_driver, 4 + 1 * RAID_OFFSET, garbage);
+  if (read_u8bit_values(2, 10, out, NULL) != STORAGE_OK || memcmp(out, data, 10 * 507) != 0)
+    return STORAGE_ERR_CORRUPT;
+  if (storage_mirror_errors(0) == 0 || storage_mirror_errors(5) != 0)
+    return STORAGE_ERR_CORRUPT;
+
+  // the tail row is continued from RAM, then primed from the card
+  if (raid_u8bit_values(data + 10 * 507, 507, &header) != STORAGE_OK ||
+      storage_flush() != STORAGE_OK || storage_revalidate() != STORAGE_OK ||
+      raid_u8bit_values(data + 11 * 507, 507, &header) != STORAGE_OK)
+    return STORAGE_ERR_DRIVER;
+  active_driver->write_block(active_driver, 4 + 3 * RAID_OFFSET, garbage);
+  if (read_u8bit_values(2, 12, out, NULL) != STORAGE_OK || memcmp(out, data, sizeof(data)) != 0)
+    return STORAGE_ERR_CORRUPT;
+
+  // the scrubber puts every sector back, parity included
+  storage_scrub_stats_t st;
+  for (int i = 0; i < 8; i++)
+    if (storage_scrub_step(64) != STORAGE_OK)
+      return STORAGE_ERR_DRIVER;
+  storage_scrub_stats(&st);
+  if (st.repaired < 6)
+    return STORAGE_ERR_CORRUPT;
+  uint64_t bad[] = { 2, 2 + 2 * RAID_OFFSET, 3 + RAID_OFFSET, 4 + RAID_OFFSET, 4 + 3 * RAID_OFFSET };
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    if (active_driver->read_block(active_driver, bad[i], garbage) != DRIVER_OK ||
+        memcmp(garbage + 1, data + (bad[i] % RAID_OFFSET - 2) * 4 * 507 + bad[i] / RAID_OFFSET * 507,
+               507) != 0)
+      return STORAGE_ERR_CORRUPT;
+  }
+
+  // three lost in one row is one too many
+  memset(garbage, 0x5A, sizeof(garbage));
+  for (uint32_t c = 0; c < 3; c++)
+    active_driver->write_block(active_driver, 3 + c * RAID_OFFSET, garbage);
+  if (read_u8bit_values(6, 1, out, NULL) != STORAGE_ERR_CORRUPT)
+    return STORAGE_ERR_CORRUPT;
+
+  // the layout is found again without superblock copy 0
+  active_driver->write_block(active_driver, 0, garbage);
+  if (storage_revalidate() != STORAGE_OK || read_u8bit_values(13, 1, out, NULL) != STORAGE_OK)
+    return STORAGE_ERR_META;
+
+  // inside a commit window the open row's parity stays in RAM until a
+  // rebuild needs it or the window closes
+  storage_commit_policy_t window = { 8, 0, NULL };
+  storage_commit_policy_t every = { 1, 0, NULL };
+  uint8_t col[2][512], par[512];
+  uint8_t rc = STORAGE_OK;
+  if (init_log_sector() != STORAGE_OK)
+    return STORAGE_ERR_META;
+  storage_set_commit_policy(&window);
+  memset(data, 0x77, 3 * 507);
+  data[507] = 0x78;
+  if (raid_u8bit_values(data, 2 * 507, &header) != STORAGE_OK)
+    rc = STORAGE_ERR_DRIVER;
+  for (uint32_t c = 0; c < 2 && rc == STORAGE_OK; c++)
+    if (active_driver->read_block(active_driver, 2 + c * RAID_OFFSET, col[c]) != DRIVER_OK)
+      rc = STORAGE_ERR_DRIVER;
+  for (size_t b = 0; b < sizeof(par); b++)
+    par[b] = col[0][b] ^ col[1][b];
+  if (rc == STORAGE_OK &&
+      (active_driver->read_block(active_driver, 2 + 4 * RAID_OFFSET, garbage) != DRIVER_OK ||
+       memcmp(garbage, par, sizeof(par)) == 0))
+    rc = STORAGE_ERR_META;
+  active_driver->write_block(active_driver, 2, garbage);
+  if (rc == STORAGE_OK && (read_u8bit_values(2, 2, out, NULL) != STORAGE_OK ||
+                           memcmp(out, data, 2 * 507) != 0))
+    rc = STORAGE_ERR_CORRUPT;
+  // the commit writes it too: two columns of the row lost afterwards
+  if (rc == STORAGE_OK && (raid_u8bit_values(data + 2 * 507, 507, &header) != STORAGE_OK ||
+                           storage_flush() != STORAGE_OK))
+    rc = STORAGE_ERR_DRIVER;
+  active_driver->write_block(active_driver, 3 + RAID_OFFSET, garbage);
+  active_driver->write_block(active_driver, 2 + 2 * RAID_OFFSET, garbage);
+  if (rc == STORAGE_OK && (read_u8bit_values(2, 3, out, NULL) != STORAGE_OK ||
+                           memcmp(out, data, 3 * 507) != 0))
+    rc = STORAGE_ERR_CORRUPT;
+  storage_set_commit_policy(&every);
+  if (rc != STORAGE_OK)
+    return rc;
+  return storage_set_redundancy(0, 0);
+}
+
+// three RAM disks behind multi_driver, one slice each: a whole disk is
+// lost and everything still reads, mirrored and as 2 + 1 parity
+uint8_t test_multi_device(void) {
+  static uint8_t disk[3][1024 * 512];
+  static driver_t devs[3];
+  static ram_ctx_t ctxs[3];
+  static uint8_t data[8 * 507], out[8 * 507];
+  driver_t *members[3];
+  driver_t *prev = active_driver;
+  storage_scrub_stats_t st;
+  uint8_t header = 0x31;
+  uint8_t rc = STORAGE_OK;
+
+  for (int i = 0; i < 3; i++) {
+    ram_driver_instance(&devs[i], &ctxs[i], disk[i], sizeof(disk[i]));
+    members[i] = &devs[i];
+  }
+  devs[2].sync = NULL;   // optional in driver_t
+  for (size_t b = 0; b < sizeof(data); b++)
+    data[b] = (uint8_t)(b * 13 + b / 507);
+  if (multi_driver_configure(members, 3, 3) != DRIVER_OK)
+    return STORAGE_ERR_PARAM;
+  active_driver = &multi_driver;
+  // a running instance is not reconfigured under its workers; init restarts it
+  if (setup_storage() != STORAGE_OK || multi_driver_configure(members, 2, 3) != DRIVER_ERR_INIT ||
+      setup_storage() != STORAGE_OK || init_log_sector() != STORAGE_OK || RAID_OFFSET != 1024) {
+    rc = STORAGE_ERR_DRIVER;
+    goto out;
+  }
+
+  // a rejected batch leaves nothing queued for the next sync
+  driver_write_t bad[2] = { { 900, 1, data + 1 }, { 901, 1, NULL } };
+  if (multi_driver.write_batch(&multi_driver, bad, 2, 0) != DRIVER_ERR_PARAM ||
+      multi_driver.sync(&multi_driver) != DRIVER_OK || disk[0][900 * 512] != 0) {
+    rc = STORAGE_ERR_PARAM;
+    goto out;
+  }
+
+  // mirror m is disk m, at the same LBAs
+  if (raid_u8bit_values(data, sizeof(data), &header) != STORAGE_OK ||
+      memcmp(disk[0], disk[1], 10 * 512) != 0 || memcmp(disk[0], disk[2], 10 * 512) != 0) {
+    rc = STORAGE_ERR_CORRUPT;
+    goto out;
+  }
+  memset(disk[1], 0, sizeof(disk[1]));
+  if (read_u8bit_values(2, 8, out, NULL) != STORAGE_OK || memcmp(out, data, sizeof(data)) != 0 ||
+      storage_mirror_errors(1) == 0) {
+    rc = STORAGE_ERR_CORRUPT;
+    goto out;
+  }
+  for (int i = 0; i < 4; i++)
+    if (storage_scrub_step(64) != STORAGE_OK)
+      rc = STORAGE_ERR_DRIVER;
+  storage_scrub_stats(&st);
+  if (rc != STORAGE_OK || memcmp(disk[0] + 2 * 512, disk[1] + 2 * 512, 8 * 512) != 0) {
+    rc = STORAGE_ERR_CORRUPT;
+    goto out;
+  }
+
+  // 2 + 1 parity: disks 0 and 1 hold data columns, disk 2 the parity
+  if (storage_set_redundancy(2, 1) != STORAGE_OK || init_log_sector() != STORAGE_OK ||
+      raid_u8bit_values(data, sizeof(data), &header) != STORAGE_OK ||
+      storage_flush() != STORAGE_OK) {
+    rc = STORAGE_ERR_DRIVER;
+    goto out;
+  }
+  memset(disk[0], 0, sizeof(disk[0]));
+  if (storage_revalidate() != STORAGE_OK || read_u8bit_values(2, 8, out, NULL) != STORAGE_OK ||
+      memcmp(out, data, sizeof(data)) != 0)
+    rc = STORAGE_ERR_CORRUPT;
+
+out:
+  storage_set_redundancy(0, 0);
+  multi_driver.deinit(&multi_driver);
+  active_driver = prev;
+  if (rc == STORAGE_OK && (init_log_sector() != STORAGE_OK || RAID_OFFSET != prev->total_sectors / RAID_MIRRORS))
+    rc = STORAGE_ERR_META;
+  return rc;
+}
+
+static uint32_t fake_ms;
+static uint32_t fake_clock(void) { return fake_ms; }
+
+static uint16_t sb_msg_count(void) {
+  uint8_t sb[512];
+  if (active_driver->read_block(active_driver, 0, sb) != DRIVER_OK)
+    return 0xFFFF;
+  return (uint16_t)(sb[3] | (sb[4] << 8));
+}
+
+// Needs an empty message log. Unflushed messages are not in the
+// superblock count until a threshold or msg_flush() writes them
+uint8_t test_msg_policy(void) {
+  storage_msg_policy_t by_count = { 4, 0, NULL };
+  storage_msg_policy_t by_time = { 0, 100, fake_clock };
+  storage_msg_policy_t off = { 0, 0, NULL };
+  uint8_t msg = 7;
+  uint8_t rc = STORAGE_OK;
+  uint8_t sec[512];
+
+  // formatting wrote it empty and sealed over the previous card's log
+  for (uint32_t m = 0; m < RAID_MIRRORS && rc == STORAGE_OK; m++) {
+    if (active_driver->read_block(active_driver, 1 + m * RAID_OFFSET, sec) != DRIVER_OK)
+      return STORAGE_ERR_DRIVER;
+    uint32_t stored = sec[508] | (sec[509] << 8) | (sec[510] << 16) | ((uint32_t)sec[511] << 24);
+    if (sec[0] != 0 || stored != crc32(sec, 508))
+      rc = STORAGE_ERR_META;
+  }
+
+  storage_set_msg_policy(&by_count);
+  for (int i = 0; i < 3; i++)
+    if (save_msg(&msg) != STORAGE_OK)
+      rc = STORAGE_ERR_DRIVER;
+  if (rc != STORAGE_OK || sb_msg_count() != 0 || save_msg(&msg) != STORAGE_OK || sb_msg_count() != 4)
+    rc = STORAGE_ERR_META;
+
+  // revalidating would reload the log and drop the staged message
+  if (rc == STORAGE_OK && (save_msg(&msg) != STORAGE_OK || storage_revalidate() != STORAGE_ERR_PARAM ||
+                           msg_flush() != STORAGE_OK || sb_msg_count() != 5 ||
+                           storage_revalidate() != STORAGE_OK))
+    rc = STORAGE_ERR_PARAM;
+
+  // the window opens with the first unflushed message
+  storage_set_msg_policy(&by_time);
+  fake_ms = 1000;
+  if (rc == STORAGE_OK && (save_msg(&msg) != STORAGE_OK || sb_msg_count() != 5))
+    rc = STORAGE_ERR_META;
+  fake_ms = 1099;
+  if (rc == STORAGE_OK && (save_msg(&msg) != STORAGE_OK || sb_msg_count() != 5))
+    rc = STORAGE_ERR_META;
+  fake_ms = 1100;
+  if (rc == STORAGE_OK && (save_msg(&msg) != STORAGE_OK || sb_msg_count() != 8))
+    rc = STORAGE_ERR_META;
+
+  storage_set_msg_policy(&off);
+  return rc;
+}
+
+static uint64_t disk_tail(void) {
+  uint8_t sb[512];
+  if (active_driver->read_block(active_driver, 0, sb) != DRIVER_OK)
+    return 0;
+  return sb_tail64(sb);
+}
+
+// Inside a commit window the data mirrors are written and readable, but
+// the superblock tail on the card only moves when the window closes
+uint8_t test_group_commit(void) {
+  storage_commit_policy_t by_count = { 3, 0, NULL };
+  storage_commit_policy_t by_time = { 100, 50, fake_clock };
+  storage_commit_policy_t every = { 1, 0, NULL };
+  uint8_t payload[507], out[2 * 507], raw[512];
+  uint8_t header = 0x41;
+  uint64_t t0 = disk_tail();
+  uint8_t rc = STORAGE_OK;
+
+  storage_set_commit_policy(&by_count);
+  for (int i = 0; i < 2 && rc == STORAGE_OK; i++) {
+    memset(payload, 0x60 + i, sizeof(payload));
+    if (raid_u8bit_values(payload, sizeof(payload), &header) != STORAGE_OK)
+      rc = STORAGE_ERR_DRIVER;
+  }
+  if (rc == STORAGE_OK && disk_tail() != t0)
+    rc = STORAGE_ERR_META;
+  for (uint32_t m = 0; m < RAID_MIRRORS && rc == STORAGE_OK; m++)
+    if (active_driver->read_block(active_driver, t0 + 2 + m * RAID_OFFSET, raw) != DRIVER_OK ||
+        raw[0] != header || raw[1] != 0x61)
+      rc = STORAGE_ERR_CORRUPT;
+  if (rc == STORAGE_OK && (read_u8bit_values(t0 + 1, 2, out, NULL) != STORAGE_OK ||
+                           out[0] != 0x60 || out[507] != 0x61))
+    rc = STORAGE_ERR_CORRUPT;
+  // max_records closes the window
+  if (rc == STORAGE_OK && (raid_u8bit_values(payload, sizeof(payload), &header) != STORAGE_OK ||
+                           disk_tail() != t0 + 3))
+    rc = STORAGE_ERR_META;
+
+  // the interval counts from the first append of the window
+  storage_set_commit_policy(&by_time);
+  uint32_t at[] = { 0, 49, 50 };
+  uint64_t want[] = { t0 + 3, t0 + 3, t0 + 6 };
+  for (int i = 0; i < 3 && rc == STORAGE_OK; i++) {
+    fake_ms = at[i];
+    if (raid_u8bit_values(payload, sizeof(payload), &header) != STORAGE_OK || disk_tail() != want[i])
+      rc = STORAGE_ERR_META;
+  }
+  if (rc == STORAGE_OK && (raid_u8bit_values(payload, sizeof(payload), &header) != STORAGE_OK ||
+                           disk_tail() != t0 + 6 || storage_flush() != STORAGE_OK ||
+                           disk_tail() != t0 + 7))
+    rc = STORAGE_ERR_META;
+
+  storage_set_commit_policy(&every);
+  return rc;
+}
+
 int main(void) {
     printf("=== MyFS Desktop Test ===\n");
 
@@ -59,6 +756,118 @@ int main(void) {
 
     printf("Write OK\n");
 
+    rc = test_read_values();
+    if (rc != STORAGE_OK) {
+        printf("test_read_values failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Read OK\n");
+
+    rc = test_scrub();
+    if (rc != STORAGE_OK) {
+        printf("test_scrub failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Scrub OK\n");
+
+    rc = test_reserve_commit();
+    if (rc != STORAGE_OK) {
+        printf("test_reserve_commit failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Reserve/commit OK\n");
+
+    rc = test_pack_records();
+    if (rc != STORAGE_OK) {
+        printf("test_pack_records failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Packed records OK\n");
+
+    rc = test_compress();
+    if (rc != STORAGE_OK) {
+        printf("test_compress failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Compression OK\n");
+
+    rc = test_columns();
+    if (rc != STORAGE_OK) {
+        printf("test_columns failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Columns OK\n");
+
+    rc = test_columns_kernels();
+    if (rc != STORAGE_OK) {
+        printf("test_columns_kernels failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Column kernels OK\n");
+
+    rc = test_save_msg();
+    if (rc != STORAGE_OK) {
+        printf("test_save_msg failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Messages OK\n");
+
+    rc = test_block_size();
+    if (rc != STORAGE_OK) {
+        printf("test_block_size failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Block size OK\n");
+
+    rc = test_wide_tail();
+    if (rc != STORAGE_OK) {
+        printf("test_wide_tail failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Wide tail OK\n");
+
+    rc = test_erasure();
+    if (rc != STORAGE_OK) {
+        printf("test_erasure failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Erasure coding OK\n");
+
+    rc = test_multi_device();
+    if (rc != STORAGE_OK) {
+        printf("test_multi_device failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Multi-device OK\n");
+
+    rc = test_msg_policy();
+    if (rc != STORAGE_OK) {
+        printf("test_msg_policy failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Message policy OK\n");
+
+    rc = test_group_commit();
+    if (rc != STORAGE_OK) {
+        printf("test_group_commit failed (%d)\n", rc);
+        return 1;
+    }
+
+    printf("Group commit OK\n");
+
     active_driver->deinit(active_driver);
     return 0;
 }